@@ -3,9 +3,34 @@
    ✅ One-time reminders
    ✅ Friendly countdown messages with task titles
    ✅ Tasks auto-deleted when reminder starts
-   ✅ CSP concepts: File I/O, Signals, Multithreading, Synchronization
+   ✅ CSP concepts: File I/O, Multithreading, Synchronization
    Compile: gcc -o reminder_final reminder_final.c -lpthread
-   Run: ./reminder_final
+   Run: ./reminder_final   [REMINDER_SHARDS=N to split the store across N locks/schedulers]
+                           [REMINDER_WORKERS=N delivery workers, default one per CPU up to 8]
+                           [REMINDER_USER=name to start as that user, REMINDER_QUOTA=N tasks per user]
+   Tools: gcc -O2 -DREMINDER_BENCH -o reminder_bench reminder_full.c -lpthread
+          ./reminder_bench sim [-n firings] [-s store] [-w horizon] [-r seed] [-S shards]
+          ./reminder_bench persist [-n 1000,10000,...] [-t title] [-c cats] [-w window] [-f file]
+          ./reminder_bench micro [-n 1000,10000,...] [-d uniform,clustered,sorted,reverse] [-S shards]
+          ./reminder_bench load [-n tasks] [-d uniform|clustered] [-w window] [-m virtual|real] [-S shards] [-v]
+          ./reminder_bench timefmt [-n samples]
+          ./reminder_bench timeparse [-n samples]
+          ./reminder_bench repl [-n tasks]
+          ./reminder_bench pitr [-n tasks]
+          ./reminder_bench archive [-n tasks]
+   Trace: REMINDER_TRACE=trace.json ./reminder_final   (open in chrome://tracing)
+   Metrics: REMINDER_METRICS=reminder.prom [REMINDER_METRICS_INTERVAL=15] ./reminder_final
+   Catch-up: REMINDER_CATCHUP=summary|top|replay [REMINDER_CATCHUP_BATCH=64]
+             [REMINDER_CATCHUP_SPACING=60] for tasks that fell due while not running
+   Digest: REMINDER_DIGEST=N [REMINDER_DIGEST_INTERVAL=300] summarizes priorities below N
+   Escalation: REMINDER_ESCALATE=N [REMINDER_ESCALATE_AFTER=300]
+               [REMINDER_ESCALATE_SINKS=stderr,file:PATH] re-notifies unacknowledged priorities >= N
+   Replication: REMINDER_REPLICATE=sock on the primary, REMINDER_STANDBY=sock on a hot
+                standby started in another directory; it takes over when the primary goes away
+   History: REMINDER_HISTORY=days keeps snapshots and journal segments for point-in-time recovery;
+            superseded snapshots are archived in a compact columnar form
+   Partitions: REMINDER_PARTITION=month|week splits each tasks file by deadline so checkpoints
+               rewrite only changed periods; [REMINDER_HORIZON=N] loads just N periods ahead
 */
 
 #define _GNU_SOURCE
@@ -14,12 +39,29 @@
 #include <string.h>
 #include <time.h>
 #include <unistd.h>
+#include <errno.h>
 #include <signal.h>
 #include <pthread.h>
+#include <sched.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <glob.h>
+#include <sys/stat.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <sys/uio.h>
+#include <sys/mman.h>
+#include <poll.h>
 
 #define TASK_FILE "tasks.txt"
+#ifndef MAX_TASKS
 #define MAX_TASKS 256
+#endif
 #define LINE_BUF 512
+#define TASK_DEPS 4
+#define TASK_LEADS 4
 
 typedef struct {
     int id;
@@ -27,254 +69,5779 @@ typedef struct {
     char category[32];
     int priority;
     time_t deadline;
+    int heap_pos;          /* position in its shard's deadline heap, -1 while parked */
+    int user;              /* owning namespace, index into users[] */
+    int after[TASK_DEPS];  /* prerequisite ids (same user), 0-terminated */
+    int lead[TASK_LEADS];  /* early reminders, seconds before the deadline,
+                              descending, 0-terminated */
+    int trig_pos[TASK_LEADS];  /* their slots in the shard's trigger heap, -1 if not armed */
 } task_t;
 
-/* Copy of tasks to pass into reminder thread */
+/* Copy of due tasks handed to delivery */
 typedef struct {
     task_t *items;
     int count;
+    int refs;              /* delivery slices still running (atomic) */
 } due_copy_t;
 
-task_t tasks[MAX_TASKS];
-int task_count = 0;
-int next_id = 1;
+/* An early reminder lead seconds before a task's deadline. The trigger
+   heap holds only these, pointing at the task's slot; the record itself is
+   never copied. */
+typedef struct {
+    time_t at;
+    int slot, k;               /* task slot, index into its lead[] */
+} trigger_t;
+
+/* The store is split by id into nshards shards. Each has its own lock,
+   deadline heap, id index and scheduler thread, so work on different shards
+   never contends. Tasks are kept dense and unordered; removal swaps in the
+   last task. */
+typedef struct {
+    pthread_mutex_t lock;
+    pthread_cond_t wake;       /* earliest deadline moved earlier, or stop */
+    task_t *tasks;
+    int count, cap;
+    int *heap;                 /* ready slots ordered by (deadline, id) */
+    int heap_n;                /* parked tasks wait outside the heap */
+    trigger_t *trig;           /* armed early reminders ordered by time */
+    int trig_n, trig_cap;
+    long long *id_keys;        /* open addressing, task_key -> slot */
+    int *id_slots;
+    int id_cap, id_bits;
+    double lock_t0;            /* trace: when the holder took the lock */
+    int index;
+    pthread_t thread;
+} shard_t;
+
+shard_t *shards = NULL;
+int nshards = 0;
+int store_count = 0;     /* tasks across all shards (atomic) */
+int max_tasks = MAX_TASKS;
+
+/* Users share the store, schedulers and executor but each has its own id
+   space, quota and tasks file. User 0 is "default" and owns task_file. */
+#ifndef MAX_USERS
+#define MAX_USERS 64
+#endif
+
+typedef struct {
+    char name[32];
+    int next_id;           /* atomic */
+    int live;              /* tasks in the store (atomic) */
+    int quota;             /* 0 = only max_tasks applies */
+    int journal_fd;        /* open journal, -1 until the first append */
+    long long journal_bytes, base_bytes;   /* atomic */
+} user_t;
+
+user_t users[MAX_USERS];
+int nusers = 0;
+int current_user = 0;    /* whose tasks the menu works on */
+
+volatile sig_atomic_t scheduler_running = 1;
+const char *task_file = TASK_FILE;   /* NULL = in-memory only */
+
+void submit_reminders(due_copy_t *dc);
+void journal_put(const task_t *t);
+void repl_ship(int u, const char *buf, size_t len);
+void repl_ship_user(int u, int drop);
+void digest_usage(size_t *bytes, int *tasks, int *cats);
+int reminder_ack(int user, int id);
+int escalation_ack(int user, int id);
+void escalation_watch(const due_copy_t *dc);
+int escalation_pending(void);
+size_t repl_usage(int *attached);
+int inflight_usage(size_t *bytes);
+/* Called by the scheduler with each due batch; owns dc. */
+void (*deliver_due)(due_copy_t *dc) = submit_reminders;
+int nworkers = 0;                /* executor workers; 0 = jobs run inline */
+int exec_pending = 0;            /* jobs queued on the executor (atomic) */
+
+/* --- Clock ---
+   Everything that reads or waits on time goes through clk, so a simulation
+   can swap real time for a virtual clock that never blocks. */
+typedef struct {
+    time_t (*now)(void);
+    void (*sleep)(unsigned secs);
+    /* Wait on cv (m held) until signalled or deadline (0 = no deadline). */
+    void (*wait_until)(pthread_cond_t *cv, pthread_mutex_t *m, time_t deadline);
+} clock_ops_t;
+
+static time_t real_now(void) { return time(NULL); }
+static void real_sleep(unsigned secs) { sleep(secs); }
+static void real_wait_until(pthread_cond_t *cv, pthread_mutex_t *m, time_t deadline) {
+    if (!deadline) { pthread_cond_wait(cv, m); return; }
+    struct timespec ts = { deadline, 0 };
+    pthread_cond_timedwait(cv, m, &ts);
+}
+
+const clock_ops_t real_clock = { real_now, real_sleep, real_wait_until };
+
+/* Virtual time only moves when someone sleeps or waits, which jumps straight
+   to the deadline. Only meaningful with a single driving thread. */
+static pthread_mutex_t vclock_mutex = PTHREAD_MUTEX_INITIALIZER;
+static time_t vclock_time = 0;
+
+static time_t virt_now(void) {
+    pthread_mutex_lock(&vclock_mutex);
+    time_t t = vclock_time;
+    pthread_mutex_unlock(&vclock_mutex);
+    return t;
+}
+
+static void virt_sleep(unsigned secs) {
+    pthread_mutex_lock(&vclock_mutex);
+    vclock_time += secs;
+    pthread_mutex_unlock(&vclock_mutex);
+}
+
+static void virt_wait_until(pthread_cond_t *cv, pthread_mutex_t *m, time_t deadline) {
+    (void)cv; (void)m;
+    pthread_mutex_lock(&vclock_mutex);
+    if (deadline > vclock_time) vclock_time = deadline;
+    pthread_mutex_unlock(&vclock_mutex);
+}
+
+const clock_ops_t virtual_clock = { virt_now, virt_sleep, virt_wait_until };
+
+const clock_ops_t *clk = &real_clock;
+
+void vclock_set(time_t t) {
+    pthread_mutex_lock(&vclock_mutex);
+    vclock_time = t;
+    pthread_mutex_unlock(&vclock_mutex);
+}
+
+/* --- Metrics ---
+   Plain counters and gauges updated with relaxed atomics, so hot paths never
+   lock. A writer thread renders them in Prometheus text format every
+   interval and renames the file into place for a textfile collector. */
+static const double late_bounds[] = { 0.1, 0.5, 1, 2, 5, 10, 30, 60 };
+#define LATE_BUCKETS (sizeof(late_bounds) / sizeof(late_bounds[0]))
+
+struct {
+    long long tasks_live;
+    unsigned long long tasks_fired;
+    unsigned long long batches;
+    unsigned long long saves;
+    unsigned long long save_bytes;
+    long long last_save_bytes;
+    long long due_inflight;          /* tasks still counting down */
+    long long last_batch;
+    long long due_bytes;             /* allocated for due batches */
+    unsigned long long late[LATE_BUCKETS + 1];
+    unsigned long long late_sum_us;
+    unsigned long long jobs_run;
+    unsigned long long jobs_stolen;
+    long long queue_peak;            /* most jobs queued on the executor at once */
+    unsigned long long journal_records;
+    unsigned long long journal_bytes;
+    unsigned long long leads_fired;
+    unsigned long long digest_tasks;
+    unsigned long long digests;
+    unsigned long long acks;
+    unsigned long long escalations;
+    unsigned long long repl_frames;  /* shipped on a primary, applied on a standby */
+    unsigned long long repl_bytes;
+    long long repl_lag_us;           /* standby: send to apply, last frame */
+    unsigned long long archive_text_bytes;   /* history snapshots archived as .col */
+    unsigned long long archive_col_bytes;
+} metrics;
+
+static const char *metrics_path;
+static unsigned metrics_interval = 15;
+
+#define METRIC_ADD(field, v) __atomic_add_fetch(&metrics.field, (v), __ATOMIC_RELAXED)
+#define METRIC_SET(field, v) __atomic_store_n(&metrics.field, (v), __ATOMIC_RELAXED)
+#define METRIC_GET(field) __atomic_load_n(&metrics.field, __ATOMIC_RELAXED)
+
+/* Seconds since the epoch with sub-second precision on the real clock. */
+double clock_now_precise(void) {
+    if (clk != &real_clock) return (double)clk->now();
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+void metrics_observe_late(double secs) {
+    if (secs < 0) secs = 0;
+    unsigned b = 0;
+    while (b < LATE_BUCKETS && secs > late_bounds[b]) b++;
+    METRIC_ADD(late[b], 1);
+    METRIC_ADD(late_sum_us, (unsigned long long)(secs * 1e6));
+}
+
+void metrics_write(void) {
+    if (!metrics_path) return;
+    char tmp[PATH_MAX];
+    snprintf(tmp, sizeof(tmp), "%s.tmp", metrics_path);
+    FILE *f = fopen(tmp, "w");
+    if (!f) { perror(tmp); return; }
+    #define GAUGE(name, help, v) \
+        fprintf(f, "# HELP " name " " help "\n# TYPE " name " gauge\n" name " %lld\n", (long long)(v))
+    #define COUNTER(name, help, v) \
+        fprintf(f, "# HELP " name " " help "\n# TYPE " name " counter\n" name " %llu\n", (unsigned long long)(v))
+    GAUGE("reminder_tasks_live", "Tasks waiting in the store.", METRIC_GET(tasks_live));
+    COUNTER("reminder_tasks_fired_total", "Tasks handed to reminder delivery.", METRIC_GET(tasks_fired));
+    COUNTER("reminder_batches_total", "Due batches fired by the scheduler.", METRIC_GET(batches));
+    GAUGE("reminder_last_batch_tasks", "Size of the most recent due batch.", METRIC_GET(last_batch));
+    COUNTER("reminder_saves_total", "Checkpoints of a user's tasks file.", METRIC_GET(saves));
+    COUNTER("reminder_save_bytes_total", "Bytes written by save_tasks().", METRIC_GET(save_bytes));
+    GAUGE("reminder_last_save_bytes", "Size of the tasks file after the last save.", METRIC_GET(last_save_bytes));
+    COUNTER("reminder_journal_records_total", "Changes appended to task journals.", METRIC_GET(journal_records));
+    COUNTER("reminder_journal_bytes_total", "Bytes appended to task journals.", METRIC_GET(journal_bytes));
+    GAUGE("reminder_executor_workers", "Delivery executor workers.", nworkers);
+    COUNTER("reminder_executor_jobs_total", "Delivery jobs run.", METRIC_GET(jobs_run));
+    COUNTER("reminder_executor_steals_total", "Jobs taken from another worker's deque.", METRIC_GET(jobs_stolen));
+    GAUGE("reminder_executor_queue_depth", "Jobs queued on the executor.", __atomic_load_n(&exec_pending, __ATOMIC_RELAXED));
+    GAUGE("reminder_executor_queue_peak", "Most jobs queued at once.", METRIC_GET(queue_peak));
+    COUNTER("reminder_leads_fired_total", "Early reminders delivered ahead of a deadline.", METRIC_GET(leads_fired));
+    COUNTER("reminder_digest_tasks_total", "Low-priority tasks folded into digests.", METRIC_GET(digest_tasks));
+    COUNTER("reminder_digests_total", "Digest summaries written.", METRIC_GET(digests));
+    COUNTER("reminder_acks_total", "In-flight reminders acknowledged.", METRIC_GET(acks));
+    COUNTER("reminder_escalations_total", "Escalation notices sent for unacknowledged reminders.", METRIC_GET(escalations));
+    COUNTER("reminder_replication_frames_total", "Journal frames shipped (primary) or applied (standby).", METRIC_GET(repl_frames));
+    COUNTER("reminder_replication_bytes_total", "Journal bytes shipped (primary) or applied (standby).", METRIC_GET(repl_bytes));
+    GAUGE("reminder_replication_lag_microseconds", "Standby: delay from shipping to applying the last frame.", METRIC_GET(repl_lag_us));
+    COUNTER("reminder_archive_text_bytes_total", "History snapshot bytes rewritten in columnar form.", METRIC_GET(archive_text_bytes));
+    COUNTER("reminder_archive_col_bytes_total", "Columnar bytes those snapshots became.", METRIC_GET(archive_col_bytes));
+    GAUGE("reminder_due_inflight", "Fired tasks still counting down.", METRIC_GET(due_inflight));
+    GAUGE("reminder_users", "User namespaces served.", __atomic_load_n(&nusers, __ATOMIC_ACQUIRE));
+    #undef GAUGE
+    #undef COUNTER
+    fprintf(f, "# HELP reminder_user_tasks_live Tasks waiting per user.\n# TYPE reminder_user_tasks_live gauge\n");
+    for (int u = 0; u < __atomic_load_n(&nusers, __ATOMIC_ACQUIRE); ++u)
+        fprintf(f, "reminder_user_tasks_live{user=\"%s\"} %d\n", users[u].name,
+                __atomic_load_n(&users[u].live, __ATOMIC_RELAXED));
+    fprintf(f, "# HELP reminder_fire_lateness_seconds Delay from deadline to firing.\n"
+               "# TYPE reminder_fire_lateness_seconds histogram\n");
+    unsigned long long cum = 0;
+    for (unsigned b = 0; b <= LATE_BUCKETS; ++b) {
+        cum += METRIC_GET(late[b]);
+        if (b < LATE_BUCKETS)
+            fprintf(f, "reminder_fire_lateness_seconds_bucket{le=\"%g\"} %llu\n", late_bounds[b], cum);
+        else
+            fprintf(f, "reminder_fire_lateness_seconds_bucket{le=\"+Inf\"} %llu\n", cum);
+    }
+    fprintf(f, "reminder_fire_lateness_seconds_sum %.6f\n", METRIC_GET(late_sum_us) / 1e6);
+    fprintf(f, "reminder_fire_lateness_seconds_count %llu\n", cum);
+    if (fclose(f) != 0 || rename(tmp, metrics_path) != 0) perror(metrics_path);
+}
+
+static void *metrics_thread_fn(void *arg) {
+    (void)arg;
+    while (1) {
+        sleep(metrics_interval);
+        metrics_write();
+    }
+    return NULL;
+}
+
+void metrics_start(void) {
+    metrics_path = getenv("REMINDER_METRICS");
+    if (!metrics_path || !*metrics_path) { metrics_path = NULL; return; }
+    const char *iv = getenv("REMINDER_METRICS_INTERVAL");
+    if (iv && atoi(iv) > 0) metrics_interval = (unsigned)atoi(iv);
+    pthread_t mt;
+    if (pthread_create(&mt, NULL, metrics_thread_fn, NULL) == 0) pthread_detach(mt);
+    else perror("pthread_create metrics");
+}
+
+/* --- Tracing ---
+   With REMINDER_TRACE set, spans are appended to per-thread chunk lists and
+   written as Chrome trace-event JSON on exit. Disabled cost is one branch.
+   A thread's buffer outlives it until dumped; one that recorded nothing is
+   freed when its thread exits. */
+#define TRACE_CHUNK 4096
+
+typedef struct {
+    const char *name;
+    double ts, dur;       /* microseconds, monotonic */
+    long long arg;
+    char ph;              /* 'X' span, 'i' instant */
+} trace_ev_t;
+
+typedef struct trace_chunk {
+    trace_ev_t ev[TRACE_CHUNK];
+    int count;                     /* published with release stores */
+    struct trace_chunk *next;
+} trace_chunk_t;
+
+typedef struct trace_buf {
+    const char *thread_name;
+    int tid;
+    trace_chunk_t *head, *tail;
+    int exited;                    /* its thread is gone; guarded by trace_mutex */
+    struct trace_buf *next;
+} trace_buf_t;
+
+int trace_enabled = 0;
+static const char *trace_path;
+static pthread_mutex_t trace_mutex = PTHREAD_MUTEX_INITIALIZER;
+static trace_buf_t *trace_bufs;
+static int trace_next_tid = 1;
+static long trace_chunks;
+static __thread trace_buf_t *trace_tls;
+static pthread_key_t trace_key;      /* runs trace_thread_exit */
+
+double trace_now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+static trace_buf_t *trace_buf(void) {
+    if (trace_tls) return trace_tls;
+    trace_buf_t *b = calloc(1, sizeof(*b));
+    b->head = b->tail = calloc(1, sizeof(trace_chunk_t));
+    __atomic_add_fetch(&trace_chunks, 1, __ATOMIC_RELAXED);
+    pthread_mutex_lock(&trace_mutex);
+    b->tid = trace_next_tid++;
+    b->next = trace_bufs;
+    trace_bufs = b;
+    pthread_mutex_unlock(&trace_mutex);
+    pthread_setspecific(trace_key, b);
+    return trace_tls = b;
+}
+
+static void trace_free(trace_buf_t *b) {
+    for (trace_chunk_t *c = b->head, *next; c; c = next) {
+        next = c->next;
+        free(c);
+        __atomic_sub_fetch(&trace_chunks, 1, __ATOMIC_RELAXED);
+    }
+    free(b);
+}
+
+/* Unlinks b from trace_bufs; caller holds trace_mutex. */
+static void trace_unlink(trace_buf_t *b) {
+    for (trace_buf_t **pp = &trace_bufs; *pp; pp = &(*pp)->next)
+        if (*pp == b) { *pp = b->next; return; }
+}
+
+static void trace_thread_exit(void *arg) {
+    trace_buf_t *b = arg;
+    pthread_mutex_lock(&trace_mutex);
+    int empty = b->head->count == 0 && !b->head->next;
+    if (empty) trace_unlink(b);
+    else b->exited = 1;
+    pthread_mutex_unlock(&trace_mutex);
+    if (empty) trace_free(b);
+}
+
+static void trace_push(const char *name, char ph, double ts, double dur, long long arg) {
+    trace_buf_t *b = trace_buf();
+    trace_chunk_t *c = b->tail;
+    if (c->count == TRACE_CHUNK) {
+        trace_chunk_t *n = calloc(1, sizeof(trace_chunk_t));
+        if (!n) return;
+        __atomic_add_fetch(&trace_chunks, 1, __ATOMIC_RELAXED);
+        __atomic_store_n(&c->next, n, __ATOMIC_RELEASE);
+        b->tail = c = n;
+    }
+    trace_ev_t *e = &c->ev[c->count];
+    e->name = name; e->ph = ph; e->ts = ts; e->dur = dur; e->arg = arg;
+    __atomic_store_n(&c->count, c->count + 1, __ATOMIC_RELEASE);
+}
+
+void trace_span(const char *name, double start_us, long long arg) {
+    if (trace_enabled) trace_push(name, 'X', start_us, trace_now_us() - start_us, arg);
+}
+
+void trace_instant(const char *name, long long arg) {
+    if (trace_enabled) trace_push(name, 'i', trace_now_us(), 0, arg);
+}
+
+void trace_thread_name(const char *name) {
+    if (trace_enabled) trace_buf()->thread_name = name;
+}
+
+#define TRACE_BEGIN(var) double var = trace_enabled ? trace_now_us() : 0
+
+void trace_init(void) {
+    trace_path = getenv("REMINDER_TRACE");
+    if (trace_path && *trace_path && pthread_key_create(&trace_key, trace_thread_exit) == 0) trace_enabled = 1;
+}
+
+/* Writes everything recorded so far; safe while other threads keep tracing.
+   Buffers of exited threads are freed once written, so dump only on exit. */
+void trace_dump(void) {
+    if (!trace_enabled) return;
+    FILE *f = fopen(trace_path, "w");
+    if (!f) { perror(trace_path); return; }
+    fprintf(f, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    int first = 1;
+    pthread_mutex_lock(&trace_mutex);
+    for (trace_buf_t *b = trace_bufs; b; b = b->next) {
+        if (b->thread_name) {
+            fprintf(f, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,"
+                    "\"args\":{\"name\":\"%s\"}}", first ? "" : ",\n", b->tid, b->thread_name);
+            first = 0;
+        }
+        for (trace_chunk_t *c = b->head; c; c = __atomic_load_n(&c->next, __ATOMIC_ACQUIRE)) {
+            int n = __atomic_load_n(&c->count, __ATOMIC_ACQUIRE);
+            for (int i = 0; i < n; ++i) {
+                trace_ev_t *e = &c->ev[i];
+                fprintf(f, "%s{\"name\":\"%s\",\"ph\":\"%c\",\"pid\":1,\"tid\":%d,\"ts\":%.3f",
+                        first ? "" : ",\n", e->name, e->ph, b->tid, e->ts);
+                if (e->ph == 'X') fprintf(f, ",\"dur\":%.3f", e->dur);
+                else fprintf(f, ",\"s\":\"t\"");
+                fprintf(f, ",\"args\":{\"n\":%lld}}", e->arg);
+                first = 0;
+            }
+        }
+    }
+    for (trace_buf_t *b = trace_bufs, *next; b; b = next) {
+        next = b->next;
+        if (b->exited) { trace_unlink(b); trace_free(b); }
+    }
+    pthread_mutex_unlock(&trace_mutex);
+    fprintf(f, "\n]}\n");
+    fclose(f);
+}
+
+/* Shard locks with wait/hold spans (arg = shard index). */
+void shard_lock(shard_t *s) {
+    if (!trace_enabled) { pthread_mutex_lock(&s->lock); return; }
+    double t0 = trace_now_us();
+    pthread_mutex_lock(&s->lock);
+    trace_span("shard lock wait", t0, s->index);
+    s->lock_t0 = trace_now_us();
+}
+
+void shard_unlock(shard_t *s) {
+    if (trace_enabled) trace_span("shard lock hold", s->lock_t0, s->index);
+    pthread_mutex_unlock(&s->lock);
+}
+
+/* Cross-shard operations take every lock, always in index order. */
+void store_lock_all(void) { for (int i = 0; i < nshards; ++i) shard_lock(&shards[i]); }
+void store_unlock_all(void) { for (int i = nshards - 1; i >= 0; --i) shard_unlock(&shards[i]); }
+
+/* Releases s while blocked; the hold span is split around the wait. */
+void shard_wait(shard_t *s, time_t deadline) {
+    if (trace_enabled) trace_span("shard lock hold", s->lock_t0, s->index);
+    clk->wait_until(&s->wake, &s->lock, deadline);
+    if (trace_enabled) s->lock_t0 = trace_now_us();
+}
+
+/* --- Executor ---
+   Reminder delivery runs as small jobs on a fixed pool of workers. Each
+   worker owns a deque: it pushes and pops at the tail, and idle workers steal
+   from the head of the others, so a burst submitted to one worker spreads over
+   the pool and a slow sink write only holds up the worker doing it. Delayed
+   jobs sit in a timer heap until due and are then submitted like any other. */
+typedef struct {
+    void (*fn)(void *);
+    void *arg;
+} job_t;
+
+typedef struct {
+    pthread_mutex_t lock;
+    job_t *ring;
+    unsigned head, tail, cap;      /* tail - head queued, cap a power of two */
+    unsigned long long run, stolen;
+    int index;
+    pthread_t thread;
+} worker_t;
+
+worker_t *workers = NULL;
+static int exec_idle;              /* workers parked on exec_wake (atomic) */
+static unsigned exec_rr;
+static pthread_mutex_t exec_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t exec_wake = PTHREAD_COND_INITIALIZER;
+static __thread worker_t *exec_self;
+
+static void worker_push(worker_t *w, job_t job) {
+    pthread_mutex_lock(&w->lock);
+    if (w->tail - w->head == w->cap) {
+        unsigned cap = w->cap ? w->cap * 2 : 64;
+        job_t *ring = malloc(sizeof(job_t) * cap);
+        for (unsigned i = 0; i < w->cap; ++i) ring[i] = w->ring[(w->head + i) & (w->cap - 1)];
+        free(w->ring);
+        w->ring = ring;
+        w->tail -= w->head;
+        w->head = 0;
+        w->cap = cap;
+    }
+    w->ring[w->tail++ & (w->cap - 1)] = job;
+    pthread_mutex_unlock(&w->lock);
+}
+
+/* Owner end: newest first, while it is still warm. */
+static int worker_pop(worker_t *w, job_t *job) {
+    int ok = 0;
+    pthread_mutex_lock(&w->lock);
+    if (w->tail != w->head) { *job = w->ring[--w->tail & (w->cap - 1)]; ok = 1; }
+    pthread_mutex_unlock(&w->lock);
+    return ok;
+}
+
+/* Thief end: oldest first. */
+static int worker_steal(worker_t *w, job_t *job) {
+    int ok = 0;
+    pthread_mutex_lock(&w->lock);
+    if (w->tail != w->head) { *job = w->ring[w->head++ & (w->cap - 1)]; ok = 1; }
+    pthread_mutex_unlock(&w->lock);
+    return ok;
+}
+
+static unsigned worker_depth(worker_t *w) {
+    pthread_mutex_lock(&w->lock);
+    unsigned n = w->tail - w->head;
+    pthread_mutex_unlock(&w->lock);
+    return n;
+}
+
+/* Workers submit to their own deque, everyone else round-robin. */
+void executor_submit(void (*fn)(void *), void *arg) {
+    if (nworkers == 0) { fn(arg); return; }
+    worker_t *w = exec_self ? exec_self
+                            : &workers[__atomic_fetch_add(&exec_rr, 1, __ATOMIC_RELAXED) % nworkers];
+    long long depth = __atomic_add_fetch(&exec_pending, 1, __ATOMIC_SEQ_CST);
+    worker_push(w, (job_t){ fn, arg });
+    long long peak = METRIC_GET(queue_peak);
+    while (depth > peak &&
+           !__atomic_compare_exchange_n(&metrics.queue_peak, &peak, depth, 1,
+                                        __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+        ;
+    if (__atomic_load_n(&exec_idle, __ATOMIC_SEQ_CST)) {
+        pthread_mutex_lock(&exec_mutex);
+        pthread_cond_signal(&exec_wake);
+        pthread_mutex_unlock(&exec_mutex);
+    }
+}
+
+static int executor_next(worker_t *w, job_t *job) {
+    if (worker_pop(w, job)) return 1;
+    for (int k = 1; k < nworkers; ++k)
+        if (worker_steal(&workers[(w->index + k) % nworkers], job)) {
+            __atomic_add_fetch(&w->stolen, 1, __ATOMIC_RELAXED);
+            METRIC_ADD(jobs_stolen, 1);
+            return 1;
+        }
+    return 0;
+}
+
+static void *worker_fn(void *arg) {
+    worker_t *w = exec_self = arg;
+    trace_thread_name("worker");
+    for (;;) {
+        job_t job;
+        if (executor_next(w, &job)) {
+            __atomic_sub_fetch(&exec_pending, 1, __ATOMIC_SEQ_CST);
+            TRACE_BEGIN(t0);
+            job.fn(job.arg);
+            trace_span("job", t0, w->index);
+            __atomic_add_fetch(&w->run, 1, __ATOMIC_RELAXED);
+            METRIC_ADD(jobs_run, 1);
+            continue;
+        }
+        /* Pending is raised before the push, so a job we missed keeps us awake. */
+        pthread_mutex_lock(&exec_mutex);
+        __atomic_add_fetch(&exec_idle, 1, __ATOMIC_SEQ_CST);
+        while (__atomic_load_n(&exec_pending, __ATOMIC_SEQ_CST) <= 0)
+            pthread_cond_wait(&exec_wake, &exec_mutex);
+        __atomic_sub_fetch(&exec_idle, 1, __ATOMIC_SEQ_CST);
+        pthread_mutex_unlock(&exec_mutex);
+    }
+    return NULL;
+}
+
+/* Timers fire on whole seconds of clk; ties run in submission order. A
+   timer armed with a handle keeps *handle at its heap position (-1 once it
+   has fired or been cancelled), so it can be cancelled in O(log n). */
+typedef struct {
+    time_t at;
+    unsigned long long seq;
+    job_t job;
+    int *handle;
+} timer_ent_t;
+
+static timer_ent_t *timer_heap;
+static int timer_count, timer_cap;
+static unsigned long long timer_seq;
+static pthread_mutex_t timer_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t timer_wake = PTHREAD_COND_INITIALIZER;
+
+static int timer_less(const timer_ent_t *a, const timer_ent_t *b) {
+    return a->at != b->at ? a->at < b->at : a->seq < b->seq;
+}
+
+static void timer_place(int i, timer_ent_t e) {
+    timer_heap[i] = e;
+    if (e.handle) *e.handle = i;
+}
+
+static int timer_up(int i, timer_ent_t e) {
+    while (i > 0 && timer_less(&e, &timer_heap[(i - 1) / 2])) {
+        timer_place(i, timer_heap[(i - 1) / 2]);
+        i = (i - 1) / 2;
+    }
+    timer_place(i, e);
+    return i;
+}
+
+static void timer_down(int i, timer_ent_t e) {
+    for (;;) {
+        int c = 2 * i + 1;
+        if (c >= timer_count) break;
+        if (c + 1 < timer_count && timer_less(&timer_heap[c + 1], &timer_heap[c])) c++;
+        if (!timer_less(&timer_heap[c], &e)) break;
+        timer_place(i, timer_heap[c]);
+        i = c;
+    }
+    timer_place(i, e);
+}
+
+/* Takes the entry at i out of the heap; caller holds timer_mutex. */
+static timer_ent_t timer_remove_locked(int i) {
+    timer_ent_t e = timer_heap[i], last = timer_heap[--timer_count];
+    if (e.handle) *e.handle = -1;
+    if (i < timer_count) timer_down(timer_up(i, last), last);
+    return e;
+}
+
+/* Runs fn(arg) on the executor once clk reaches at; handle may be NULL. */
+void timer_arm(time_t at, void (*fn)(void *), void *arg, int *handle) {
+    if (nworkers == 0) {
+        time_t now = clk->now();
+        if (handle) *handle = -1;
+        if (at > now) clk->sleep((unsigned)(at - now));
+        fn(arg);
+        return;
+    }
+    pthread_mutex_lock(&timer_mutex);
+    if (timer_count == timer_cap) {
+        timer_cap = timer_cap ? timer_cap * 2 : 64;
+        timer_heap = realloc(timer_heap, sizeof(timer_ent_t) * timer_cap);
+    }
+    timer_ent_t e = { at, timer_seq++, { fn, arg }, handle };
+    if (timer_up(timer_count++, e) == 0) pthread_cond_signal(&timer_wake);
+    pthread_mutex_unlock(&timer_mutex);
+}
+
+void timer_at(time_t at, void (*fn)(void *), void *arg) { timer_arm(at, fn, arg, NULL); }
+
+/* Returns 1 if the timer was still pending and will now never run. */
+int timer_cancel(int *handle) {
+    pthread_mutex_lock(&timer_mutex);
+    int pending = *handle >= 0;
+    if (pending) timer_remove_locked(*handle);
+    pthread_mutex_unlock(&timer_mutex);
+    return pending;
+}
+
+static void *timer_thread_fn(void *arg) {
+    (void)arg;
+    trace_thread_name("timer");
+    pthread_mutex_lock(&timer_mutex);
+    for (;;) {
+        if (timer_count == 0) { clk->wait_until(&timer_wake, &timer_mutex, 0); continue; }
+        if (timer_heap[0].at > clk->now()) {
+            clk->wait_until(&timer_wake, &timer_mutex, timer_heap[0].at);
+            continue;
+        }
+        timer_ent_t e = timer_remove_locked(0);
+        pthread_mutex_unlock(&timer_mutex);
+        executor_submit(e.job.fn, e.job.arg);
+        pthread_mutex_lock(&timer_mutex);
+    }
+    return NULL;
+}
+
+/* n workers (REMINDER_WORKERS, default one per CPU up to 8) plus the timer
+   thread. Without a call to this, submitted jobs run inline. */
+void executor_start(int n) {
+    if (nworkers) return;
+    if (n <= 0) {
+        const char *e = getenv("REMINDER_WORKERS");
+        long ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+        n = e && atoi(e) > 0 ? atoi(e) : ncpu < 1 ? 1 : ncpu > 8 ? 8 : (int)ncpu;
+    }
+    workers = calloc(n, sizeof(worker_t));
+    for (int i = 0; i < n; ++i) {
+        pthread_mutex_init(&workers[i].lock, NULL);
+        workers[i].index = i;
+    }
+    nworkers = n;
+    for (int i = 0; i < n; ++i)
+        if (pthread_create(&workers[i].thread, NULL, worker_fn, &workers[i]) != 0)
+            perror("pthread_create worker");
+    pthread_t tt;
+    if (pthread_create(&tt, NULL, timer_thread_fn, NULL) == 0) pthread_detach(tt);
+    else perror("pthread_create timer");
+}
+
+/* --- Helpers --- */
+void format_time_strftime(time_t t, char *buf, size_t n) {
+    struct tm tm;
+    localtime_r(&t, &tm);
+    strftime(buf, n, "%Y-%m-%d %H:%M", &tm);
+}
+
+/* UTC offsets change only at DST/zone transitions, so each thread caches a
+   few [lo, hi) spans of constant offset and skips localtime_r (and glibc's
+   timezone lock) inside them. Transitions are assumed at least TZ_STEP
+   apart, which holds for every zone in tzdata. */
+#define TZ_STEP (7 * 86400)
+#define TZ_REACH (400 * 86400)
+#define TZ_CACHE 4
+
+typedef struct { time_t lo, hi; long off; } tz_span_t;
+
+static __thread tz_span_t tz_cache[TZ_CACHE];
+static __thread int tz_cache_next;
+
+static long tz_offset_raw(time_t t) {
+    struct tm tm;
+    localtime_r(&t, &tm);
+    return tm.tm_gmtoff;
+}
+
+/* First second in (same, diff] whose offset is not off. */
+static time_t tz_bisect(time_t same, time_t diff, long off) {
+    while ((diff > same ? diff - same : same - diff) > 1) {
+        time_t mid = same + (diff - same) / 2;
+        if (tz_offset_raw(mid) == off) same = mid; else diff = mid;
+    }
+    return diff;
+}
+
+static const tz_span_t *tz_span(time_t t) {
+    for (int i = 0; i < TZ_CACHE; ++i)
+        if (tz_cache[i].hi > tz_cache[i].lo && t >= tz_cache[i].lo && t < tz_cache[i].hi)
+            return &tz_cache[i];
+
+    long off = tz_offset_raw(t);
+    time_t hi = t, lo = t;
+    for (;;) {
+        if (hi - t >= TZ_REACH) break;
+        time_t probe = hi + TZ_STEP;
+        if (tz_offset_raw(probe) != off) { hi = tz_bisect(hi, probe, off); break; }
+        hi = probe;
+    }
+    if (hi == t) hi = t + 1;
+    for (;;) {
+        if (t - lo >= TZ_REACH) break;
+        time_t probe = lo - TZ_STEP;
+        if (tz_offset_raw(probe) != off) { lo = tz_bisect(lo, probe, off) + 1; break; }
+        lo = probe;
+    }
+    tz_span_t *e = &tz_cache[tz_cache_next];
+    tz_cache_next = (tz_cache_next + 1) % TZ_CACHE;
+    e->lo = lo; e->hi = hi; e->off = off;
+    return e;
+}
+
+long tz_offset(time_t t) { return tz_span(t)->off; }
+
+/* Days since 1970-01-01 to civil date (proleptic Gregorian). */
+static void civil_from_days(long long z, int *y, int *m, int *d) {
+    z += 719468;
+    long long era = (z >= 0 ? z : z - 146096) / 146097;
+    unsigned doe = (unsigned)(z - era * 146097);
+    unsigned yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    unsigned doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    unsigned mp = (5 * doy + 2) / 153;
+    *d = (int)(doy - (153 * mp + 2) / 5 + 1);
+    *m = (int)(mp < 10 ? mp + 3 : mp - 9);
+    *y = (int)(yoe + era * 400 + (*m <= 2));
+}
+
+/* Civil date to days since 1970-01-01. */
+static long long days_from_civil(int y, int m, int d) {
+    y -= m <= 2;
+    long long era = (y >= 0 ? y : y - 399) / 400;
+    unsigned yoe = (unsigned)(y - era * 400);
+    unsigned doy = (153 * (m > 2 ? m - 3 : m + 9) + 2) / 5 + d - 1;
+    unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + (long long)doe - 719468;
+}
+
+static int days_in_month(int y, int m) {
+    static const int dim[] = { 31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31 };
+    return m == 2 && (y % 4 == 0 && (y % 100 != 0 || y % 400 == 0)) ? 29 : dim[m - 1];
+}
+
+/* Local wall-clock seconds (as if UTC) to an instant. Transitions are at
+   least TZ_STEP apart, so only the offsets a day either side can apply.
+   Ambiguous times take the first occurrence; times skipped by a forward
+   jump are read with the earlier offset, landing just after the jump. */
+time_t local_to_utc(long long local) {
+    long before = tz_offset((time_t)(local - 86400));
+    long after = tz_offset((time_t)(local + 86400));
+    time_t ta = (time_t)(local - before), tb = (time_t)(local - after);
+    int va = tz_offset(ta) == before, vb = tz_offset(tb) == after;
+    if (va && vb) return ta < tb ? ta : tb;
+    if (vb) return tb;
+    return ta;
+}
+
+static int parse_digits(const char *s, int n) {
+    int v = 0;
+    for (int i = 0; i < n; ++i) v = v * 10 + (s[i] - '0');
+    return v;
+}
+
+/* Parses "YYYY-MM-DD HH:MM[:SS]" (local), the same with 'T' and an optional
+   "Z" or "+HH[:]MM" zone up to +-14:00 (ISO 8601), or "@epoch". A bare
+   number is refused so a typo like "2026" is not taken as 1970. The fixed
+   layout is validated in one branch-free pass over the template. Returns 1
+   on success. Replaces strptime + mktime. */
+int parse_deadline(const char *str, time_t *out) {
+    static const char tmpl[] = "dddd-dd-dd dd:dd:dd";
+    while (*str == ' ') str++;
+    size_t len = strlen(str);
+    while (len && (str[len-1] == ' ' || str[len-1] == '\r')) len--;
+
+    if (len && str[0] == '@') {
+        size_t i = 1, start = 1;
+        int neg = 0;
+        if (str[i] == '-') { neg = 1; i++; start++; }
+        long long v = 0;
+        for (; i < len && str[i] >= '0' && str[i] <= '9' && i - start < 18; ++i) v = v * 10 + (str[i] - '0');
+        if (i == len && i > start) { *out = (time_t)(neg ? -v : v); return 1; }
+        return 0;
+    }
+
+    if (len < 16) return 0;
+    size_t body = len >= 19 && str[16] == ':' ? 19 : 16;
+    unsigned bad = 0;
+    for (size_t i = 0; i < body; ++i) {
+        unsigned c = (unsigned char)str[i];
+        unsigned sep = tmpl[i] == ' ' ? (c != ' ' && c != 'T') : c != (unsigned char)tmpl[i];
+        bad |= tmpl[i] == 'd' ? (c - '0') > 9 : sep;
+    }
+    if (bad) return 0;
+
+    int y = parse_digits(str, 4), mo = parse_digits(str + 5, 2), d = parse_digits(str + 8, 2);
+    int h = parse_digits(str + 11, 2), mi = parse_digits(str + 14, 2);
+    int sec = body == 19 ? parse_digits(str + 17, 2) : 0;
+    if (mo < 1 || mo > 12 || d < 1 || d > days_in_month(y, mo) || h > 23 || mi > 59 || sec > 60) return 0;
+    long long local = days_from_civil(y, mo, d) * 86400 + h * 3600 + mi * 60 + sec;
+
+    const char *z = str + body;
+    size_t zlen = len - body;
+    if (zlen == 0) { *out = local_to_utc(local); return 1; }
+    if (str[10] != 'T') return 0;
+    if (zlen == 1 && z[0] == 'Z') { *out = (time_t)local; return 1; }
+    if ((zlen == 6 && z[3] == ':') || zlen == 5) {
+        const char *mm = z + (zlen == 6 ? 4 : 3);
+        if ((z[0] != '+' && z[0] != '-') || (unsigned)(z[1] - '0') > 9 || (unsigned)(z[2] - '0') > 9 ||
+            (unsigned)(mm[0] - '0') > 9 || (unsigned)(mm[1] - '0') > 9) return 0;
+        int oh = parse_digits(z + 1, 2), om = parse_digits(mm, 2);
+        if (om > 59 || oh * 60 + om > 14 * 60) return 0;
+        int off = oh * 3600 + om * 60;
+        *out = (time_t)(local - (z[0] == '-' ? -off : off));
+        return 1;
+    }
+    return 0;
+}
+
+static const char digits2[] =
+    "00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+    "40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+    "8081828384858687888990919293949596979899";
+
+/* "%Y-%m-%d %H:%M" in local time, identical to format_time_strftime(). */
+void format_time(time_t t, char *buf, size_t n) {
+    long long local = (long long)t + tz_offset(t);
+    long long days = local >= 0 ? local / 86400 : -((-local + 86399) / 86400);
+    int secs = (int)(local - days * 86400);
+    int y, m, d;
+    civil_from_days(days, &y, &m, &d);
+    if (n < 17 || y < 0 || y > 9999) { format_time_strftime(t, buf, n); return; }
+    int hh = secs / 3600, mm = secs / 60 % 60;
+    memcpy(buf, digits2 + 2 * (y / 100), 2);
+    memcpy(buf + 2, digits2 + 2 * (y % 100), 2);
+    buf[4] = '-';
+    memcpy(buf + 5, digits2 + 2 * m, 2);
+    buf[7] = '-';
+    memcpy(buf + 8, digits2 + 2 * d, 2);
+    buf[10] = ' ';
+    memcpy(buf + 11, digits2 + 2 * hh, 2);
+    buf[13] = ':';
+    memcpy(buf + 14, digits2 + 2 * mm, 2);
+    buf[16] = 0;
+}
+
+/* Sorts a 0-terminated lead list descending and drops repeats. */
+void leads_normalize(int *lead) {
+    int n = 0;
+    while (n < TASK_LEADS && lead[n]) n++;
+    for (int i = 1; i < n; ++i)
+        for (int j = i; j > 0 && lead[j] > lead[j - 1]; --j) { int v = lead[j]; lead[j] = lead[j - 1]; lead[j - 1] = v; }
+    int k = 0;
+    for (int i = 0; i < n; ++i) if (!k || lead[i] != lead[k - 1]) lead[k++] = lead[i];
+    while (k < TASK_LEADS) lead[k++] = 0;
+}
+
+/* Parses early reminder offsets like "1d,1h,10m" (units d/h/m/s, plain
+   numbers are minutes; "1h30m" works) into lead. Returns 1 on success. */
+int parse_leads(const char *str, int *lead) {
+    int n = 0;
+    memset(lead, 0, sizeof(int) * TASK_LEADS);
+    while (*str) {
+        if (*str == ',' || *str == ' ') { str++; continue; }
+        long long secs = 0;
+        while (*str && *str != ',' && *str != ' ') {
+            char *end;
+            long long v = strtoll(str, &end, 10);
+            if (end == str || v <= 0) return 0;
+            int unit = *end == 'd' ? 86400 : *end == 'h' ? 3600 : *end == 's' ? 1 : 60;
+            if (*end == 'd' || *end == 'h' || *end == 'm' || *end == 's') end++;
+            else if (*end && *end != ',' && *end != ' ') return 0;
+            if ((secs += v * unit) > INT_MAX) return 0;
+            str = end;
+        }
+        if (n == TASK_LEADS) return 0;
+        lead[n++] = (int)secs;
+    }
+    leads_normalize(lead);
+    return 1;
+}
+
+/* Renders a lead list as "1d,1h30m,10m" ("none" if empty). */
+void format_leads(const int *lead, char *buf, size_t n) {
+    static const struct { int secs; char unit; } units[] = { {86400, 'd'}, {3600, 'h'}, {60, 'm'}, {1, 's'} };
+    size_t len = 0;
+    buf[0] = 0;
+    for (int k = 0; k < TASK_LEADS && lead[k]; ++k) {
+        int v = lead[k];
+        if (k && len + 1 < n) buf[len++] = ',';
+        for (int u = 0; u < 4; ++u)
+            if (v >= units[u].secs && len < n) {
+                len += snprintf(buf + len, n - len, "%d%c", v / units[u].secs, units[u].unit);
+                v %= units[u].secs;
+            }
+        if (len >= n) len = n - 1;
+    }
+    if (!len) snprintf(buf, n, "none");
+    else buf[len] = 0;
+}
+
+/* --- Users ---
+   Names are [A-Za-z0-9_-]. The default user keeps task_file; everyone else
+   gets the same path with ".name" before the extension (tasks.alice.txt). */
+static pthread_mutex_t users_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static int user_name_ok(const char *name) {
+    size_t n = strlen(name);
+    if (n == 0 || n >= sizeof(users[0].name)) return 0;
+    return strspn(name, "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789_-") == n;
+}
+
+/* Index of name, registering it when create is set; -1 if unknown, invalid
+   or out of slots. REMINDER_QUOTA caps each user's live tasks. */
+int user_find(const char *name, int create) {
+    int found = -1;
+    pthread_mutex_lock(&users_mutex);
+    for (int i = 0; i < nusers && found < 0; ++i)
+        if (strcmp(users[i].name, name) == 0) found = i;
+    if (found < 0 && create && nusers < MAX_USERS && user_name_ok(name)) {
+        user_t *u = &users[nusers];
+        memset(u, 0, sizeof(*u));
+        strcpy(u->name, name);
+        u->next_id = 1;
+        u->journal_fd = -1;
+        const char *q = getenv("REMINDER_QUOTA");
+        u->quota = q && atoi(q) > 0 ? atoi(q) : 0;
+        found = nusers;
+        __atomic_store_n(&nusers, nusers + 1, __ATOMIC_RELEASE);
+    }
+    pthread_mutex_unlock(&users_mutex);
+    return found;
+}
+
+/* Length of task_file up to the extension of its last path component. */
+static size_t task_file_stem(void) {
+    const char *base = strrchr(task_file, '/');
+    const char *dot = strrchr(base ? base : task_file, '.');
+    return dot && dot != (base ? base + 1 : task_file) ? (size_t)(dot - task_file) : strlen(task_file);
+}
+
+void user_file(int u, char *buf, size_t n) {
+    if (u == 0) { snprintf(buf, n, "%s", task_file); return; }
+    size_t stem = task_file_stem();
+    snprintf(buf, n, "%.*s.%s%s", (int)stem, task_file, users[u].name, task_file + stem);
+}
+
+/* Registers every user that has a file, or a partition directory, next to
+   task_file. */
+static void users_discover(void) {
+    size_t stem = task_file_stem();
+    char pattern[PATH_MAX];
+    snprintf(pattern, sizeof(pattern), "%.*s.*%s", (int)stem, task_file, task_file + stem);
+    glob_t g;
+    if (glob(pattern, 0, NULL, &g) != 0) g.gl_pathc = 0;
+    snprintf(pattern + strlen(pattern), sizeof(pattern) - strlen(pattern), ".parts");
+    if (glob(pattern, g.gl_pathc ? GLOB_APPEND : 0, NULL, &g) != 0 && !g.gl_pathc) return;
+    size_t ext = strlen(task_file + stem);
+    for (size_t i = 0; i < g.gl_pathc; ++i) {
+        const char *p = g.gl_pathv[i];
+        size_t len = strlen(p);
+        if (len > 6 && strcmp(p + len - 6, ".parts") == 0) len -= 6;
+        if (len <= stem + 1 + ext) continue;
+        char name[sizeof(users[0].name)];
+        snprintf(name, sizeof(name), "%.*s", (int)(len - stem - 1 - ext), p + stem + 1);
+        user_find(name, 1);
+    }
+    globfree(&g);
+}
+
+/* --- Partitions ---
+   With REMINDER_PARTITION=month (or week) a user's checkpoint is split by
+   deadline, local time, into <file>.parts/2026-10.txt (weeks are named by
+   their Monday, 2026-10-12.txt). The store notes which periods each change
+   touches and a checkpoint rewrites only those, so a partition nobody
+   changed, in practice every past one and most future ones, is never
+   written again and is only ever read, through a read-only mapping. With
+   REMINDER_HORIZON=N only partitions up to N periods ahead are loaded; the
+   rest stay cold on disk until the horizon reaches them or a change lands
+   in them. A lookup by id that misses, a bulk change whose dates reach them
+   or a loaded task waiting on a task they may hold loads a user's cold
+   partitions early; the task list reads them without loading. parts/next
+   keeps the id counter so new ids never collide with cold tasks. */
+enum { PART_OFF, PART_MONTH, PART_WEEK };
+static int part_mode = PART_OFF;
+static int part_horizon = 0;     /* periods ahead to load, 0 = all */
+static int part_quiet = 0;       /* set while loading partitions: nothing changed */
+
+typedef struct {
+    int *ids;
+    int n, cap;
+} part_set_t;
+
+/* Dirty periods are guarded by part_mutex (changes hold only one shard
+   lock); cold ones by holding every shard lock. */
+static part_set_t part_dirty[MAX_USERS], part_cold[MAX_USERS];
+static pthread_mutex_t part_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static long long floor_div(long long a, long long b) { return a / b - (a % b < 0); }
+
+/* Period holding t: months since year 0, or weeks since the epoch's Monday. */
+static int part_of(time_t t) {
+    long long days = floor_div((long long)t + tz_offset(t), 86400);
+    if (part_mode == PART_WEEK) return (int)floor_div(days + 3, 7);
+    int y, m, d;
+    civil_from_days(days, &y, &m, &d);
+    return y * 12 + m - 1;
+}
+
+/* First local day of period id, in days since the epoch. */
+static long long part_start_days(int id) {
+    if (part_mode == PART_WEEK) return (long long)id * 7 - 3;
+    long long y = floor_div(id, 12);
+    return days_from_civil((int)y, (int)(id - y * 12) + 1, 1);
+}
+
+static void part_dir(int u, char *buf, size_t n) {
+    user_file(u, buf, n);
+    size_t len = strlen(buf);
+    snprintf(buf + len, n - len, ".parts");
+}
+
+static void part_path(int u, int id, char *buf, size_t n) {
+    int y, m, d;
+    civil_from_days(part_start_days(id), &y, &m, &d);
+    part_dir(u, buf, n);
+    size_t len = strlen(buf);
+    if (part_mode == PART_WEEK) snprintf(buf + len, n - len, "/%04d-%02d-%02d.txt", y, m, d);
+    else snprintf(buf + len, n - len, "/%04d-%02d.txt", y, m);
+}
+
+/* Period a partition file is named for, INT_MIN if it is not one of ours. */
+static int part_parse(const char *path) {
+    const char *base = strrchr(path, '/');
+    int y, m, d, n = sscanf(base ? base + 1 : path, "%d-%d-%d", &y, &m, &d);
+    if (n < 2 || m < 1 || m > 12 || (n == 3) != (part_mode == PART_WEEK)) return INT_MIN;
+    if (n == 3) return (int)floor_div(days_from_civil(y, m, d) + 3, 7);
+    return y * 12 + m - 1;
+}
+
+static int part_has(const part_set_t *s, int id) {
+    for (int i = 0; i < s->n; ++i)
+        if (s->ids[i] == id) return 1;
+    return 0;
+}
+
+static void part_add(part_set_t *s, int id) {
+    if (part_has(s, id)) return;
+    if (s->n == s->cap) {
+        int cap = s->cap ? s->cap * 2 : 8;
+        int *ids = realloc(s->ids, sizeof(int) * cap);
+        if (!ids) { perror("partitions"); return; }
+        s->ids = ids;
+        s->cap = cap;
+    }
+    s->ids[s->n++] = id;
+}
+
+static void part_forget(part_set_t *s, int id) {
+    for (int i = 0; i < s->n; ++i)
+        if (s->ids[i] == id) { s->ids[i] = s->ids[--s->n]; return; }
+}
+
+/* Notes that u's partition holding deadline changed; caller holds a shard lock. */
+static void part_touch(int u, time_t deadline) {
+    if (part_mode == PART_OFF || part_quiet) return;
+    int id = part_of(deadline);
+    pthread_mutex_lock(&part_mutex);
+    part_add(&part_dirty[u], id);
+    pthread_mutex_unlock(&part_mutex);
+}
+
+void part_config(void) {
+    const char *p = getenv("REMINDER_PARTITION");
+    if (p && strcmp(p, "month") == 0) part_mode = PART_MONTH;
+    else if (p && strcmp(p, "week") == 0) part_mode = PART_WEEK;
+    else if (p && *p) fprintf(stderr, "Unknown REMINDER_PARTITION '%s', using one file.\n", p);
+    if (part_mode && (p = getenv("REMINDER_HORIZON")) && atoi(p) > 0) part_horizon = atoi(p);
+}
+
+/* --- Task store --- */
+#define ID_EMPTY INT_MIN
+#define KEY_EMPTY LLONG_MIN
+
+/* Ids repeat across users, so the store is keyed by (user, id). */
+static long long task_key(int user, int id) { return (long long)user << 32 | (unsigned)id; }
+
+static shard_t *shard_for(long long key) { return &shards[(unsigned long long)key % (unsigned)nshards]; }
+
+/* Make room for n tasks in s; caller holds the lock. Returns 0 on failure. */
+static int shard_reserve(shard_t *s, int n) {
+    if (n <= s->cap) return 1;
+    int cap = s->cap ? s->cap : 64;
+    while (cap < n) cap *= 2;
+    task_t *t = realloc(s->tasks, sizeof(task_t) * cap);
+    if (!t) return 0;
+    s->tasks = t;
+    int *h = realloc(s->heap, sizeof(int) * cap);
+    if (!h) return 0;
+    s->heap = h;
+    s->cap = cap;
+    return 1;
+}
+
+/* Id index: linear probing on a Fibonacci hash, load factor <= 1/2. */
+static unsigned idmap_home(const shard_t *s, long long key) {
+    return (unsigned)(((unsigned long long)key * 11400714819323198485ull) >> (64 - s->id_bits));
+}
+
+static int idmap_find(const shard_t *s, long long key) {
+    if (!s->id_cap) return -1;
+    unsigned mask = (unsigned)s->id_cap - 1;
+    for (unsigned i = idmap_home(s, key); ; i = (i + 1) & mask) {
+        if (s->id_keys[i] == key) return (int)i;
+        if (s->id_keys[i] == KEY_EMPTY) return -1;
+    }
+}
+
+static void idmap_set(shard_t *s, long long key, int slot) {
+    unsigned mask = (unsigned)s->id_cap - 1, i = idmap_home(s, key);
+    while (s->id_keys[i] != KEY_EMPTY && s->id_keys[i] != key) i = (i + 1) & mask;
+    s->id_keys[i] = key;
+    s->id_slots[i] = slot;
+}
+
+static int idmap_reserve(shard_t *s, int n) {
+    if (2 * n <= s->id_cap) return 1;
+    int bits = s->id_bits ? s->id_bits : 6;
+    while ((1 << bits) < 2 * n) bits++;
+    int cap = 1 << bits, *slots = malloc(sizeof(int) * cap);
+    long long *keys = malloc(sizeof(long long) * cap);
+    if (!keys || !slots) { free(keys); free(slots); return 0; }
+    for (int i = 0; i < cap; ++i) keys[i] = KEY_EMPTY;
+    long long *old_keys = s->id_keys;
+    int *old_slots = s->id_slots, old_cap = s->id_cap;
+    s->id_keys = keys; s->id_slots = slots; s->id_cap = cap; s->id_bits = bits;
+    for (int i = 0; i < old_cap; ++i)
+        if (old_keys[i] != KEY_EMPTY) idmap_set(s, old_keys[i], old_slots[i]);
+    free(old_keys);
+    free(old_slots);
+    return 1;
+}
+
+/* Backward-shift deletion keeps probe chains intact without tombstones. */
+static void idmap_erase(shard_t *s, long long key) {
+    int i = idmap_find(s, key);
+    if (i < 0) return;
+    unsigned mask = (unsigned)s->id_cap - 1, hole = (unsigned)i, j = hole;
+    for (;;) {
+        j = (j + 1) & mask;
+        if (s->id_keys[j] == KEY_EMPTY) break;
+        unsigned home = idmap_home(s, s->id_keys[j]);
+        if (hole <= j ? (hole < home && home <= j) : (hole < home || home <= j)) continue;
+        s->id_keys[hole] = s->id_keys[j];
+        s->id_slots[hole] = s->id_slots[j];
+        hole = j;
+    }
+    s->id_keys[hole] = KEY_EMPTY;
+}
+
+/* Deadline heap over slots; each task records its heap position. */
+static int heap_less(const shard_t *s, int a, int b) {
+    const task_t *x = &s->tasks[a], *y = &s->tasks[b];
+    if (x->deadline != y->deadline) return x->deadline < y->deadline;
+    return x->user != y->user ? x->user < y->user : x->id < y->id;
+}
+
+static void heap_set(shard_t *s, int pos, int slot) {
+    s->heap[pos] = slot;
+    s->tasks[slot].heap_pos = pos;
+}
+
+static void heap_up(shard_t *s, int pos) {
+    int slot = s->heap[pos];
+    while (pos > 0) {
+        int parent = (pos - 1) / 2;
+        if (!heap_less(s, slot, s->heap[parent])) break;
+        heap_set(s, pos, s->heap[parent]);
+        pos = parent;
+    }
+    heap_set(s, pos, slot);
+}
+
+static void heap_down(shard_t *s, int pos) {
+    int slot = s->heap[pos];
+    for (;;) {
+        int c = 2 * pos + 1;
+        if (c >= s->heap_n) break;
+        if (c + 1 < s->heap_n && heap_less(s, s->heap[c + 1], s->heap[c])) c++;
+        if (!heap_less(s, s->heap[c], slot)) break;
+        heap_set(s, pos, s->heap[c]);
+        pos = c;
+    }
+    heap_set(s, pos, slot);
+}
+
+/* Restores heap order after the task at pos changed its deadline. */
+static void heap_fix(shard_t *s, int pos) {
+    int slot = s->heap[pos];
+    heap_up(s, pos);
+    heap_down(s, s->tasks[slot].heap_pos);
+}
+
+/* Earliest ready deadline in s, 0 if none; caller holds the lock. */
+static time_t shard_top(const shard_t *s) {
+    return s->heap_n ? s->tasks[s->heap[0]].deadline : 0;
+}
+
+/* Trigger heap: a second, much smaller min-heap per shard holding the
+   early reminders of ready tasks. Each task records where its triggers sit,
+   so dropping a task disarms them in O(triggers) without a search. */
+static void trig_set(shard_t *s, int pos, trigger_t e) {
+    s->trig[pos] = e;
+    s->tasks[e.slot].trig_pos[e.k] = pos;
+}
+
+static void trig_up(shard_t *s, int pos) {
+    trigger_t e = s->trig[pos];
+    while (pos > 0) {
+        int parent = (pos - 1) / 2;
+        if (s->trig[parent].at <= e.at) break;
+        trig_set(s, pos, s->trig[parent]);
+        pos = parent;
+    }
+    trig_set(s, pos, e);
+}
+
+static void trig_down(shard_t *s, int pos) {
+    trigger_t e = s->trig[pos];
+    for (;;) {
+        int c = 2 * pos + 1;
+        if (c >= s->trig_n) break;
+        if (c + 1 < s->trig_n && s->trig[c + 1].at < s->trig[c].at) c++;
+        if (s->trig[c].at >= e.at) break;
+        trig_set(s, pos, s->trig[c]);
+        pos = c;
+    }
+    trig_set(s, pos, e);
+}
+
+static void trig_remove(shard_t *s, int pos) {
+    trigger_t e = s->trig[pos];
+    s->tasks[e.slot].trig_pos[e.k] = -1;
+    int last = --s->trig_n;
+    if (pos == last) return;
+    e = s->trig[last];
+    trig_set(s, pos, e);
+    trig_up(s, pos);
+    trig_down(s, s->tasks[e.slot].trig_pos[e.k]);
+}
+
+/* Earliest moment s's scheduler has work: a ready deadline or a trigger. */
+static time_t shard_next(const shard_t *s) {
+    time_t a = shard_top(s), b = s->trig_n ? s->trig[0].at : 0;
+    return !a || (b && b < a) ? b : a;
+}
+
+/* Arms the task's triggers that are still ahead; ones already passed are
+   skipped, not fired late. Wakes the scheduler if one comes first. */
+static void trig_arm(shard_t *s, int slot) {
+    task_t *t = &s->tasks[slot];
+    if (!t->lead[0]) return;
+    time_t next = shard_next(s), now = clk->now();
+    for (int k = 0; k < TASK_LEADS && t->lead[k]; ++k) {
+        time_t at = t->deadline - t->lead[k];
+        if (t->trig_pos[k] >= 0 || at <= now) continue;
+        if (s->trig_n == s->trig_cap) {
+            int cap = s->trig_cap ? s->trig_cap * 2 : 16;
+            trigger_t *p = realloc(s->trig, sizeof(trigger_t) * cap);
+            if (!p) return;
+            s->trig = p;
+            s->trig_cap = cap;
+        }
+        trig_set(s, s->trig_n, (trigger_t){ at, slot, k });
+        trig_up(s, s->trig_n++);
+        if (!next || at < next) { pthread_cond_signal(&s->wake); next = at; }
+    }
+}
+
+static void trig_disarm(shard_t *s, int slot) {
+    for (int k = 0; k < TASK_LEADS; ++k)
+        if (s->tasks[slot].trig_pos[k] >= 0) trig_remove(s, s->tasks[slot].trig_pos[k]);
+}
+
+/* A parked task stays in the store but out of the heap, so it never
+   fires; unparking wakes the scheduler if it is now the earliest. Its
+   early reminders are disarmed and rearmed with it. */
+static void shard_park(shard_t *s, int slot) {
+    trig_disarm(s, slot);
+    int pos = s->tasks[slot].heap_pos, last = --s->heap_n;
+    if (pos < 0) { s->heap_n++; return; }
+    if (pos != last) {
+        heap_set(s, pos, s->heap[last]);
+        heap_fix(s, pos);
+    }
+    s->tasks[slot].heap_pos = -1;
+}
+
+static void shard_unpark(shard_t *s, int slot) {
+    if (s->tasks[slot].heap_pos >= 0) return;
+    time_t top = shard_top(s);
+    heap_set(s, s->heap_n, slot);
+    heap_up(s, s->heap_n++);
+    if (top == 0 || s->tasks[slot].deadline < top) pthread_cond_signal(&s->wake);
+    trig_arm(s, slot);
+}
+
+static void next_id_at_least(user_t *u, int id) {
+    int cur = __atomic_load_n(&u->next_id, __ATOMIC_RELAXED);
+    while (id >= cur && !__atomic_compare_exchange_n(&u->next_id, &cur, id + 1, 1,
+                                                     __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+        ;
+}
+
+/* Adds a copy of t keeping its id; caller holds s->lock. Returns 0 if the
+   store or the user's quota is full or the id is taken. */
+static int shard_put_locked(shard_t *s, const task_t *t) {
+    user_t *u = &users[t->user];
+    int full = __atomic_add_fetch(&store_count, 1, __ATOMIC_RELAXED) > max_tasks;
+    int live = __atomic_add_fetch(&u->live, 1, __ATOMIC_RELAXED);
+    if (full || (u->quota && live > u->quota) || t->id == ID_EMPTY ||
+        idmap_find(s, task_key(t->user, t->id)) >= 0 ||
+        !shard_reserve(s, s->count + 1) || !idmap_reserve(s, s->count + 1)) {
+        __atomic_sub_fetch(&store_count, 1, __ATOMIC_RELAXED);
+        __atomic_sub_fetch(&u->live, 1, __ATOMIC_RELAXED);
+        return 0;
+    }
+    time_t top = shard_top(s);
+    int slot = s->count++;
+    s->tasks[slot] = *t;
+    for (int k = 0; k < TASK_LEADS; ++k) s->tasks[slot].trig_pos[k] = -1;
+    heap_set(s, s->heap_n, slot);
+    heap_up(s, s->heap_n++);
+    idmap_set(s, task_key(t->user, t->id), slot);
+    next_id_at_least(u, t->id);
+    METRIC_ADD(tasks_live, 1);
+    if (top == 0 || t->deadline < top) pthread_cond_signal(&s->wake);
+    trig_arm(s, slot);
+    part_touch(t->user, t->deadline);
+    return 1;
+}
+
+/* Drops the task in slot; caller holds s->lock. */
+static void shard_remove_slot(shard_t *s, int slot) {
+    user_t *u = &users[s->tasks[slot].user];
+    part_touch(s->tasks[slot].user, s->tasks[slot].deadline);
+    idmap_erase(s, task_key(s->tasks[slot].user, s->tasks[slot].id));
+    shard_park(s, slot);
+    int last = --s->count;
+    if (slot != last) {
+        s->tasks[slot] = s->tasks[last];
+        if (s->tasks[slot].heap_pos >= 0) s->heap[s->tasks[slot].heap_pos] = slot;
+        for (int k = 0; k < TASK_LEADS; ++k)
+            if (s->tasks[slot].trig_pos[k] >= 0) s->trig[s->tasks[slot].trig_pos[k]].slot = slot;
+        idmap_set(s, task_key(s->tasks[slot].user, s->tasks[slot].id), slot);
+    }
+    __atomic_sub_fetch(&store_count, 1, __ATOMIC_RELAXED);
+    __atomic_sub_fetch(&u->live, 1, __ATOMIC_RELAXED);
+    METRIC_ADD(tasks_live, -1);
+}
+
+/* Fields for shard_update_slot(). */
+#define UPD_TITLE    1
+#define UPD_CATEGORY 2
+#define UPD_PRIORITY 4
+#define UPD_DEADLINE 8
+#define UPD_LEAD     16
+#define UPD_ALL      31
+
+/* Copies the fields picked by mask from src into the task in slot; a new
+   deadline moves it up or down the heap in place (decrease/increase-key).
+   A new deadline or lead list rearms the task's triggers. Caller holds
+   s->lock. Wakes the scheduler if the earliest deadline moved. */
+static void shard_update_slot(shard_t *s, int slot, const task_t *src, unsigned mask) {
+    task_t *t = &s->tasks[slot];
+    time_t top = shard_top(s);
+    int rearm = (mask & UPD_LEAD) && memcmp(t->lead, src->lead, sizeof(t->lead)) != 0;
+    part_touch(t->user, t->deadline);
+    if (mask & UPD_TITLE) memcpy(t->title, src->title, sizeof(t->title));
+    if (mask & UPD_CATEGORY) memcpy(t->category, src->category, sizeof(t->category));
+    if (mask & UPD_PRIORITY) t->priority = src->priority;
+    if (rearm) { trig_disarm(s, slot); memcpy(t->lead, src->lead, sizeof(t->lead)); }
+    if ((mask & UPD_DEADLINE) && t->deadline != src->deadline) {
+        if (!rearm) trig_disarm(s, slot);
+        rearm = 1;
+        t->deadline = src->deadline;
+        part_touch(t->user, t->deadline);
+        if (t->heap_pos >= 0) heap_fix(s, t->heap_pos);
+        if (shard_top(s) != top) pthread_cond_signal(&s->wake);
+    }
+    if (rearm && t->heap_pos >= 0) trig_arm(s, slot);
+}
+
+/* Replaces the task with t's key in place, or adds it; caller holds s->lock. */
+static int shard_upsert_locked(shard_t *s, const task_t *t) {
+    int i = idmap_find(s, task_key(t->user, t->id));
+    if (i < 0) return shard_put_locked(s, t);
+    shard_update_slot(s, s->id_slots[i], t, UPD_ALL);
+    return 1;
+}
+
+/* Selects one user's tasks; unset fields match anything. */
+typedef struct {
+    int user;
+    const char *category;      /* exact, NULL = any */
+    const char *title;         /* substring, NULL = any */
+    int pri_min, pri_max;      /* inclusive */
+    time_t from, to;           /* deadline in [from, to), 0 = open */
+} task_filter_t;
+
+void filter_init(task_filter_t *f, int user) {
+    memset(f, 0, sizeof(*f));
+    f->user = user;
+    f->pri_min = INT_MIN;
+    f->pri_max = INT_MAX;
+}
+
+static int filter_match(const task_filter_t *f, const task_t *t) {
+    return t->user == f->user && t->priority >= f->pri_min && t->priority <= f->pri_max &&
+           (!f->from || t->deadline >= f->from) && (!f->to || t->deadline < f->to) &&
+           (!f->category || strcmp(t->category, f->category) == 0) &&
+           (!f->title || strstr(t->title, f->title));
+}
+
+/* Slots of s matching f, into sel (room for s->count); caller holds the
+   lock. With an upper deadline bound the heap is walked and every subtree
+   rooted at or past it skipped, so only tasks due before it are visited;
+   parked tasks are not in the heap, so a shard holding any is scanned. */
+static int shard_select(shard_t *s, const task_filter_t *f, int *sel) {
+    int n = 0;
+    if (!f->to || s->heap_n < s->count) {
+        for (int i = 0; i < s->count; ++i)
+            if (filter_match(f, &s->tasks[i])) sel[n++] = i;
+        return n;
+    }
+    int *stack = malloc(sizeof(int) * (s->heap_n + 1)), sp = 0;
+    if (!stack) return 0;
+    if (s->heap_n) stack[sp++] = 0;
+    while (sp) {
+        int pos = stack[--sp], slot = s->heap[pos];
+        if (s->tasks[slot].deadline >= f->to) continue;
+        if (filter_match(f, &s->tasks[slot])) sel[n++] = slot;
+        if (2 * pos + 1 < s->heap_n) stack[sp++] = 2 * pos + 1;
+        if (2 * pos + 2 < s->heap_n) stack[sp++] = 2 * pos + 2;
+    }
+    free(stack);
+    return n;
+}
+
+static int cmp_int_desc(const void *a, const void *b) {
+    int x = *(const int *)a, y = *(const int *)b;
+    return (x < y) - (x > y);
+}
+
+/* Pops every task due at now in deadline order into a fresh array (*out,
+   NULL if none); caller holds s->lock. Returns the number taken. */
+static int shard_take_due(shard_t *s, time_t now, task_t **out) {
+    int n = 0, cap = 0;
+    *out = NULL;
+    while (s->heap_n && shard_top(s) <= now) {
+        if (n == cap) {
+            cap = cap ? cap * 2 : 16;
+            task_t *p = realloc(*out, sizeof(task_t) * cap);
+            if (!p) break;
+            *out = p;
+        }
+        (*out)[n++] = s->tasks[s->heap[0]];
+        shard_remove_slot(s, s->heap[0]);
+    }
+    return n;
+}
+
+/* A trigger that fired: a copy of its task and which lead it was. */
+typedef struct {
+    task_t task;
+    int lead;
+} lead_hit_t;
+
+/* Pops every trigger due at now into a fresh array (*out, NULL if none);
+   caller holds s->lock. The tasks stay in the store. */
+static int shard_take_leads(shard_t *s, time_t now, lead_hit_t **out) {
+    int n = 0, cap = 0;
+    *out = NULL;
+    while (s->trig_n && s->trig[0].at <= now) {
+        if (n == cap) {
+            cap = cap ? cap * 2 : 8;
+            lead_hit_t *p = realloc(*out, sizeof(lead_hit_t) * cap);
+            if (!p) break;
+            *out = p;
+        }
+        const task_t *t = &s->tasks[s->trig[0].slot];
+        (*out)[n].task = *t;
+        (*out)[n++].lead = t->lead[s->trig[0].k];
+        trig_remove(s, 0);
+    }
+    return n;
+}
+
+/* Empties every shard; caller holds all locks. With release, frees memory. */
+static void store_clear_locked(int release) {
+    for (int i = 0; i < nshards; ++i) {
+        shard_t *s = &shards[i];
+        METRIC_ADD(tasks_live, -s->count);
+        __atomic_sub_fetch(&store_count, s->count, __ATOMIC_RELAXED);
+        s->count = s->heap_n = s->trig_n = 0;
+        for (int k = 0; k < s->id_cap; ++k) s->id_keys[k] = KEY_EMPTY;
+        if (release) {
+            free(s->tasks); free(s->heap); free(s->id_keys); free(s->id_slots); free(s->trig);
+            s->tasks = NULL; s->heap = s->id_slots = NULL; s->id_keys = NULL; s->trig = NULL;
+            s->cap = s->id_cap = s->id_bits = s->trig_cap = 0;
+        }
+    }
+    for (int u = 0; u < nusers; ++u) {
+        __atomic_store_n(&users[u].next_id, 1, __ATOMIC_RELAXED);
+        __atomic_store_n(&users[u].live, 0, __ATOMIC_RELAXED);
+    }
+}
+
+void store_clear(void) {
+    store_lock_all();
+    store_clear_locked(1);
+    store_unlock_all();
+}
+
+void store_init(int n) {
+    if (n < 1) n = 1;
+    shards = calloc((size_t)n, sizeof(shard_t));
+    nshards = n;
+    for (int i = 0; i < n; ++i) {
+        pthread_mutex_init(&shards[i].lock, NULL);
+        pthread_cond_init(&shards[i].wake, NULL);
+        shards[i].index = i;
+    }
+    if (nusers == 0) user_find("default", 1);
+}
+
+/* Adds a copy of t keeping its id; returns 1 on success. */
+int store_put(const task_t *t) {
+    shard_t *s = shard_for(task_key(t->user, t->id));
+    shard_lock(s);
+    int ok = shard_put_locked(s, t);
+    if (ok) journal_put(t);
+    shard_unlock(s);
+    return ok;
+}
+
+static int cmp_deadline(const void *a, const void *b) {
+    const task_t *x = a, *y = b;
+    if (x->deadline != y->deadline) return x->deadline < y->deadline ? -1 : 1;
+    if (x->user != y->user) return x->user < y->user ? -1 : 1;
+    return (x->id > y->id) - (x->id < y->id);
+}
+
+/* Every task ordered by (deadline, id): each shard sorts its own run under
+   its lock, then the runs are merged. Caller frees; *n gets the count. */
+task_t *store_snapshot_sorted(int *n) {
+    task_t **runs = calloc((size_t)nshards, sizeof(task_t *));
+    int *len = calloc((size_t)nshards, sizeof(int)), *at = calloc((size_t)nshards, sizeof(int));
+    int total = 0;
+    for (int i = 0; i < nshards; ++i) {
+        shard_t *s = &shards[i];
+        shard_lock(s);
+        len[i] = s->count;
+        runs[i] = malloc(sizeof(task_t) * (s->count ? s->count : 1));
+        memcpy(runs[i], s->tasks, sizeof(task_t) * s->count);
+        shard_unlock(s);
+        qsort(runs[i], len[i], sizeof(task_t), cmp_deadline);
+        total += len[i];
+    }
+    task_t *out = malloc(sizeof(task_t) * (total ? total : 1));
+    for (int k = 0; k < total; ++k) {
+        int best = -1;
+        for (int i = 0; i < nshards; ++i)
+            if (at[i] < len[i] && (best < 0 || cmp_deadline(&runs[i][at[i]], &runs[best][at[best]]) < 0))
+                best = i;
+        out[k] = runs[best][at[best]++];
+    }
+    for (int i = 0; i < nshards; ++i) free(runs[i]);
+    free(runs); free(len); free(at);
+    *n = total;
+    return out;
+}
+
+/* --- Serialization ---
+   One record per line: id|title|category|priority|deadline, then optional
+   |key=value fields (after=3,5 lists prerequisites, lead=86400,600 early
+   reminders in seconds); readers skip keys they do not know. Inside title
+   and category, '\\', '|', newline and CR are written as \\ \| \n \r so
+   user text can never split a record. Files from before escaping load the
+   same unless a title or category holds a backslash followed by n, r, | or
+   \\, which now reads as that escape; any other backslash is kept. */
+#define SAVE_BUF (256 * 1024)
+#define RECORD_MAX 512     /* worst case: every text byte escaped */
+
+static char *put_uint(char *p, unsigned long long v) {
+    char tmp[20];
+    int n = 0;
+    do { tmp[n++] = (char)('0' + v % 10); v /= 10; } while (v);
+    while (n) *p++ = tmp[--n];
+    return p;
+}
+
+static char *put_int(char *p, long long v) {
+    if (v < 0) { *p++ = '-'; return put_uint(p, 0ULL - (unsigned long long)v); }
+    return put_uint(p, (unsigned long long)v);
+}
+
+static char *put_text(char *p, const char *s, size_t max) {
+    size_t len = strnlen(s, max);
+    size_t plain = strcspn(s, "\\|\n\r");
+    if (plain >= len) { memcpy(p, s, len); return p + len; }
+    for (size_t i = 0; i < len; ++i) {
+        char c = s[i];
+        switch (c) {
+            case '\\': *p++ = '\\'; *p++ = '\\'; break;
+            case '|':  *p++ = '\\'; *p++ = '|'; break;
+            case '\n': *p++ = '\\'; *p++ = 'n'; break;
+            case '\r': *p++ = '\\'; *p++ = 'r'; break;
+            default:   *p++ = c;
+        }
+    }
+    return p;
+}
+
+/* Renders one record including the newline; p needs RECORD_MAX bytes. */
+char *serialize_task(char *p, const task_t *t) {
+    p = put_int(p, t->id);
+    *p++ = '|';
+    p = put_text(p, t->title, sizeof(t->title));
+    *p++ = '|';
+    p = put_text(p, t->category, sizeof(t->category));
+    *p++ = '|';
+    p = put_int(p, t->priority);
+    *p++ = '|';
+    p = put_int(p, (long long)t->deadline);
+    for (int k = 0; k < TASK_DEPS && t->after[k]; ++k) {
+        if (k == 0) { memcpy(p, "|after=", 7); p += 7; }
+        else *p++ = ',';
+        p = put_int(p, t->after[k]);
+    }
+    for (int k = 0; k < TASK_LEADS && t->lead[k]; ++k) {
+        if (k == 0) { memcpy(p, "|lead=", 6); p += 6; }
+        else *p++ = ',';
+        p = put_int(p, t->lead[k]);
+    }
+    *p++ = '\n';
+    return p;
+}
+
+/* Unescapes one text field starting at s into dst (truncating at n-1);
+   returns a pointer to the terminating '|' or NUL. */
+static char *take_text(char *s, char *dst, size_t n) {
+    size_t k = 0;
+    for (; *s && *s != '|'; ++s) {
+        char c = *s;
+        if (c == '\\' && s[1]) {
+            char e = *++s;
+            c = e == 'n' ? '\n' : e == 'r' ? '\r' : e == '|' || e == '\\' ? e : 0;
+            if (!c) { if (k < n - 1) dst[k++] = '\\'; c = e; }
+        }
+        if (k < n - 1) dst[k++] = c;
+    }
+    dst[k] = 0;
+    return s;
+}
+
+static char *take_number(char *s, long long *v) {
+    char *end;
+    errno = 0;
+    *v = strtoll(s, &end, 10);
+    if (end == s || errno) return NULL;
+    return end;
+}
+
+/* Reads a comma-separated list of positive ints into dst, keeping the first
+   max; returns a pointer just past the list. */
+static char *take_list(char *p, int *dst, int max) {
+    for (int k = 0; ; ++p) {
+        long long v;
+        char *q = take_number(p, &v);
+        if (!q) break;
+        if (k < max && v > 0 && v <= INT_MAX) dst[k++] = (int)v;
+        p = q;
+        if (*p != ',') break;
+    }
+    return p;
+}
+
+/* Parses a record (without its newline) into t; returns 1 if well formed. */
+int parse_task_line(char *line, task_t *t) {
+    long long id, pr, dl;
+    char *p = take_number(line, &id);
+    if (!p || *p != '|') return 0;
+    memset(t, 0, sizeof(*t));
+    p = take_text(p + 1, t->title, sizeof(t->title));
+    if (*p != '|') return 0;
+    p = take_text(p + 1, t->category, sizeof(t->category));
+    if (*p != '|') return 0;
+    if (!(p = take_number(p + 1, &pr)) || *p != '|') return 0;
+    if (!(p = take_number(p + 1, &dl))) return 0;
+    if (id < INT_MIN || id > INT_MAX || pr < INT_MIN || pr > INT_MAX) return 0;
+    while (*p == '|') {
+        ++p;
+        if (strncmp(p, "after=", 6) == 0) p = take_list(p + 6, t->after, TASK_DEPS);
+        else if (strncmp(p, "lead=", 5) == 0) {
+            p = take_list(p + 5, t->lead, TASK_LEADS);
+            leads_normalize(t->lead);
+        }
+        p += strcspn(p, "|");
+    }
+    t->id = (int)id;
+    t->priority = (int)pr;
+    t->deadline = (time_t)dl;
+    return 1;
+}
+
+/* --- Journal ---
+   Between checkpoints a user's changes are appended to <file>.journal instead
+   of rewriting the file: "+|record" adds or replaces a task, "-|id" drops
+   one. Appends are made under the lock of the shard that changed, so for any
+   task the journal order is the store order. Once a journal outgrows its
+   file by JOURNAL_SLACK, a checkpoint rewrites the file and removes it.
+   With history on, every write is preceded by "@|<microseconds>" and a
+   checkpoint archives the journal instead (see History). */
+#define JOURNAL_SLACK (64 * 1024)
+
+long long history_keep_us = 0;   /* REMINDER_HISTORY days in us; 0 = no history */
+
+static void journal_path(int u, char *buf, size_t n) {
+    user_file(u, buf, n);
+    size_t len = strlen(buf);
+    snprintf(buf + len, n - len, ".journal");
+}
+
+static void journal_write(int u, const char *buf, size_t len) {
+    user_t *us = &users[u];
+    repl_ship(u, buf, len);
+    int fd = __atomic_load_n(&us->journal_fd, __ATOMIC_ACQUIRE);
+    if (fd < 0) {
+        char path[PATH_MAX];
+        journal_path(u, path, sizeof(path));
+        int nfd = open(path, O_WRONLY | O_APPEND | O_CREAT, 0644);
+        if (nfd < 0) { perror(path); return; }
+        /* Another shard may have opened it first; keep theirs. */
+        if (__atomic_compare_exchange_n(&us->journal_fd, &fd, nfd, 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+            fd = nfd;
+        else
+            close(nfd);
+    }
+    /* Marker and records go out in one append so shards cannot interleave. */
+    char mark[32], *m = mark;
+    if (history_keep_us) {
+        *m++ = '@'; *m++ = '|';
+        m = put_int(m, (long long)(clock_now_precise() * 1e6));
+        *m++ = '\n';
+    }
+    size_t mlen = (size_t)(m - mark), total = mlen + len;
+    struct iovec iov[2] = { { mark, mlen }, { (void *)buf, len } };
+    ssize_t r;
+    while ((r = writev(fd, iov, 2)) < 0 && errno == EINTR)
+        ;
+    if (r < 0) { perror("journal"); return; }
+    for (size_t off = (size_t)r; off < total; ) {
+        const char *src = off < mlen ? mark + off : buf + (off - mlen);
+        ssize_t w = write(fd, src, off < mlen ? mlen - off : total - off);
+        if (w < 0) { if (errno == EINTR) continue; perror("journal"); return; }
+        off += (size_t)w;
+    }
+    __atomic_add_fetch(&us->journal_bytes, (long long)total, __ATOMIC_RELAXED);
+    METRIC_ADD(journal_bytes, total);
+}
+
+void journal_put(const task_t *t) {
+    if (!task_file) return;
+    char rec[RECORD_MAX + 2], *p = rec;
+    *p++ = '+'; *p++ = '|';
+    p = serialize_task(p, t);
+    journal_write(t->user, rec, (size_t)(p - rec));
+    METRIC_ADD(journal_records, 1);
+}
+
+/* Puts for one user's changed tasks, written SAVE_BUF at a time. */
+void journal_put_batch(const task_t *items, int n) {
+    if (!task_file || n <= 0) return;
+    char *buf = malloc(SAVE_BUF), *p = buf;
+    if (!buf) { for (int i = 0; i < n; ++i) journal_put(&items[i]); return; }
+    for (int i = 0; i < n; ++i) {
+        if (p - buf > SAVE_BUF - RECORD_MAX - 2) {
+            journal_write(items[0].user, buf, (size_t)(p - buf));
+            p = buf;
+        }
+        *p++ = '+'; *p++ = '|';
+        p = serialize_task(p, &items[i]);
+    }
+    journal_write(items[0].user, buf, (size_t)(p - buf));
+    METRIC_ADD(journal_records, n);
+    free(buf);
+}
+
+/* Drops for removed tasks, one write per run of the same user's. */
+void journal_drop(const task_t *items, int n) {
+    if (!task_file || n <= 0) return;
+    char buf[4096];
+    size_t len = 0;
+    for (int i = 0; i < n; ++i) {
+        if (len > sizeof(buf) - 32 || (i && items[i].user != items[i - 1].user)) {
+            journal_write(items[i - 1].user, buf, len);
+            len = 0;
+        }
+        char *p = buf + len;
+        *p++ = '-'; *p++ = '|';
+        p = put_int(p, items[i].id);
+        *p++ = '\n';
+        len = (size_t)(p - buf);
+    }
+    journal_write(items[n - 1].user, buf, len);
+    METRIC_ADD(journal_records, n);
+}
+
+/* --- Dependencies ---
+   A task may wait on up to TASK_DEPS other tasks of the same user (its after
+   list). While any of them is still in the store the task is parked: it
+   keeps its record but sits outside the deadline heap, so it cannot fire.
+   Each graph node counts its pending prerequisites and lists its
+   dependents, so when a task fires or is deleted only those dependents are
+   touched; one whose count reaches zero is unparked, firing at once if it
+   is already overdue. Nodes exist only for tasks with edges, and a
+   prerequisite already gone when the edge is made counts as done. */
+typedef struct dep_node {
+    long long key;
+    int pending;                 /* prerequisites still in the store */
+    long long after[TASK_DEPS];
+    int nafter;
+    long long *deps;             /* dependents */
+    int ndeps, capdeps;
+    unsigned mark;               /* cycle search generation */
+    struct dep_node *next;
+} dep_node_t;
+
+static dep_node_t **dep_tab;
+static int dep_cap, dep_nodes;
+static unsigned dep_gen;
+static int dep_edges;            /* atomic; 0 lets removals skip the graph */
+static pthread_mutex_t dep_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static dep_node_t **dep_link_of(long long key) {
+    dep_node_t **l = &dep_tab[((unsigned long long)key * 11400714819323198485ull) >> 40 & (dep_cap - 1)];
+    while (*l && (*l)->key != key) l = &(*l)->next;
+    return l;
+}
+
+static dep_node_t *dep_find(long long key) {
+    return dep_cap ? *dep_link_of(key) : NULL;
+}
+
+static dep_node_t *dep_get(long long key) {
+    if (dep_nodes >= dep_cap / 2) {
+        int cap = dep_cap ? dep_cap * 2 : 64;
+        dep_node_t **old = dep_tab;
+        int old_cap = dep_cap;
+        dep_tab = calloc(cap, sizeof(*dep_tab));
+        dep_cap = cap;
+        for (int i = 0; i < old_cap; ++i)
+            for (dep_node_t *n = old[i], *next; n; n = next) {
+                next = n->next;
+                dep_node_t **l = dep_link_of(n->key);
+                n->next = *l;
+                *l = n;
+            }
+        free(old);
+    }
+    dep_node_t **l = dep_link_of(key);
+    if (!*l) {
+        *l = calloc(1, sizeof(dep_node_t));
+        (*l)->key = key;
+        dep_nodes++;
+    }
+    return *l;
+}
+
+static void dep_drop_node(dep_node_t *n) {
+    dep_node_t **l = dep_link_of(n->key);
+    *l = n->next;
+    free(n->deps);
+    free(n);
+    dep_nodes--;
+}
+
+static void dep_forget(long long *list, int *n, long long key) {
+    for (int i = 0; i < *n; ++i)
+        if (list[i] == key) { list[i] = list[--*n]; return; }
+}
+
+/* Does following after edges from `from` reach `to`? Caller holds dep_mutex. */
+static int dep_reaches(long long from, long long to) {
+    if (from == to) return 1;
+    dep_node_t *n = dep_find(from);
+    if (!n) return 0;
+    unsigned gen = ++dep_gen;
+    int cap = 64, sp = 0;
+    dep_node_t **stack = malloc(sizeof(*stack) * cap);
+    stack[sp++] = n;
+    n->mark = gen;
+    int found = 0;
+    while (sp && !found) {
+        n = stack[--sp];
+        for (int i = 0; i < n->nafter && !found; ++i) {
+            if (n->after[i] == to) { found = 1; break; }
+            dep_node_t *m = dep_find(n->after[i]);
+            if (!m || m->mark == gen) continue;
+            m->mark = gen;
+            if (sp == cap) stack = realloc(stack, sizeof(*stack) * (cap *= 2));
+            stack[sp++] = m;
+        }
+    }
+    free(stack);
+    return found;
+}
+
+/* Records that task waits on pre (both in the store); caller holds
+   dep_mutex. Returns 0 if the edge would close a cycle or is a repeat. */
+static int dep_link(long long task, long long pre) {
+    dep_node_t *t = dep_find(task);
+    if (t) for (int i = 0; i < t->nafter; ++i) if (t->after[i] == pre) return 0;
+    if (dep_reaches(pre, task) || (t && t->nafter == TASK_DEPS)) return 0;
+    t = dep_get(task);
+    dep_node_t *p = dep_get(pre);
+    t->after[t->nafter++] = pre;
+    t->pending++;
+    if (p->ndeps == p->capdeps) {
+        p->capdeps = p->capdeps ? p->capdeps * 2 : 4;
+        p->deps = realloc(p->deps, sizeof(long long) * p->capdeps);
+    }
+    p->deps[p->ndeps++] = task;
+    __atomic_add_fetch(&dep_edges, 1, __ATOMIC_RELAXED);
+    return 1;
+}
+
+static void dep_clear_locked(void) {
+    for (int i = 0; i < dep_cap; ++i)
+        for (dep_node_t *n = dep_tab[i], *next; n; n = next) {
+            next = n->next;
+            free(n->deps);
+            free(n);
+        }
+    free(dep_tab);
+    dep_tab = NULL;
+    dep_cap = dep_nodes = 0;
+    __atomic_store_n(&dep_edges, 0, __ATOMIC_RELAXED);
+}
+
+/* Tasks that left the store (fired or deleted): drops them from their
+   dependents' after lists, journaling each changed record so a later load
+   or a reused id cannot bring the edge back, and unparks the dependents now
+   free. Call without any shard lock held. */
+void deps_done(const task_t *items, int n) {
+    if (n <= 0 || !__atomic_load_n(&dep_edges, __ATOMIC_RELAXED)) return;
+    struct { long long key; int pre, ready; } *hit = NULL;
+    int nhit = 0, cap = 0;
+    pthread_mutex_lock(&dep_mutex);
+    for (int i = 0; i < n; ++i) {
+        dep_node_t *node = dep_find(task_key(items[i].user, items[i].id));
+        if (!node) continue;
+        for (int k = 0; k < node->ndeps; ++k) {
+            dep_node_t *d = dep_find(node->deps[k]);
+            if (!d) continue;
+            dep_forget(d->after, &d->nafter, node->key);
+            if (nhit == cap) hit = realloc(hit, sizeof(*hit) * (cap = cap ? cap * 2 : 16));
+            hit[nhit].key = d->key;
+            hit[nhit].pre = items[i].id;
+            hit[nhit++].ready = --d->pending == 0;
+            if (!d->nafter && !d->ndeps) dep_drop_node(d);
+        }
+        /* Deleted while still waiting: drop it from its prerequisites. */
+        for (int k = 0; k < node->nafter; ++k) {
+            dep_node_t *p = dep_find(node->after[k]);
+            if (!p) continue;
+            dep_forget(p->deps, &p->ndeps, node->key);
+            if (!p->nafter && !p->ndeps) dep_drop_node(p);
+        }
+        __atomic_sub_fetch(&dep_edges, node->ndeps + node->nafter, __ATOMIC_RELAXED);
+        dep_drop_node(node);
+    }
+    pthread_mutex_unlock(&dep_mutex);
+    for (int i = 0; i < nhit; ++i) {
+        shard_t *s = shard_for(hit[i].key);
+        shard_lock(s);
+        int k = idmap_find(s, hit[i].key);
+        if (k >= 0) {
+            int slot = s->id_slots[k];
+            task_t *t = &s->tasks[slot];
+            int j = 0;
+            while (j < TASK_DEPS && t->after[j] && t->after[j] != hit[i].pre) ++j;
+            if (j < TASK_DEPS && t->after[j]) {
+                memmove(&t->after[j], &t->after[j + 1], sizeof(t->after[0]) * (TASK_DEPS - 1 - j));
+                t->after[TASK_DEPS - 1] = 0;
+                part_touch(t->user, t->deadline);
+                journal_put(t);
+            }
+            if (hit[i].ready) shard_unpark(s, slot);
+        }
+        shard_unlock(s);
+    }
+    free(hit);
+}
+
+/* Rebuilds the graph from every task's after list and parks the tasks
+   still waiting; caller holds all shard locks. Edges to tasks no longer in
+   the store, and edges that would close a cycle, are ignored. */
+static void deps_rebuild_locked(void) {
+    pthread_mutex_lock(&dep_mutex);
+    dep_clear_locked();
+    for (int si = 0; si < nshards; ++si)
+        for (int i = 0; i < shards[si].count; ++i) {
+            const task_t *t = &shards[si].tasks[i];
+            for (int k = 0; k < TASK_DEPS && t->after[k]; ++k) {
+                long long pre = task_key(t->user, t->after[k]);
+                if (idmap_find(shard_for(pre), pre) >= 0) dep_link(task_key(t->user, t->id), pre);
+            }
+        }
+    for (int i = 0; i < dep_cap; ++i)
+        for (dep_node_t *n = dep_tab[i]; n; n = n->next) {
+            if (!n->pending) continue;
+            shard_t *s = shard_for(n->key);
+            int k = idmap_find(s, n->key);
+            if (k >= 0) shard_park(s, s->id_slots[k]);
+        }
+    pthread_mutex_unlock(&dep_mutex);
+}
+
+static int part_thaw_locked(int u, time_t from, time_t to);
+
+/* Makes user's task id wait for task pre. Returns 1 on success, 0 if either
+   task is missing, -1 if the edge would close a cycle (or repeats one),
+   -2 if id already waits on TASK_DEPS tasks. */
+int task_add_after(int user, int id, int pre) {
+    long long kt = task_key(user, id), kp = task_key(user, pre);
+    int rc = 0;
+    store_lock_all();
+    shard_t *s = shard_for(kt);
+    int it = idmap_find(s, kt), ip = idmap_find(shard_for(kp), kp);
+    if ((it < 0 || ip < 0) && part_thaw_locked(user, 0, 0)) {
+        deps_rebuild_locked();
+        it = idmap_find(s, kt);
+        ip = idmap_find(shard_for(kp), kp);
+    }
+    if (it >= 0 && ip >= 0) {
+        task_t *t = &s->tasks[s->id_slots[it]];
+        int n = 0;
+        while (n < TASK_DEPS && t->after[n]) n++;
+        if (n == TASK_DEPS) rc = -2;
+        else {
+            pthread_mutex_lock(&dep_mutex);
+            rc = dep_link(kt, kp) ? 1 : -1;
+            pthread_mutex_unlock(&dep_mutex);
+        }
+        if (rc == 1) {
+            t->after[n] = pre;
+            shard_park(s, s->id_slots[it]);
+            journal_put(t);
+        }
+    }
+    store_unlock_all();
+    return rc;
+}
+
+/* Load & Save Tasks
+   Each user's tasks live in their own file plus journal; ids are that user's. */
+
+/* --- Columnar archive ---
+   A history snapshot that no live file shares any more is re-encoded
+   column by column as <name>.col, several times smaller than the text and
+   decoded without parsing a line:
+     "RCOL1\n", then LEB128 varints (signed values zigzagged):
+     n            rows, sorted by deadline
+     deadlines    the first, then deltas
+     ids          zigzagged deltas from the previous row
+     priorities   min, width w, then n w-bit fields packed LSB first
+     categories   dictionary size d, d x (length, bytes), then n codes packed
+                  like priorities
+     titles       n lengths, then the bytes back to back
+     extras       count, then for each row with dependencies or early
+                  reminders: row delta, count and ids, count and seconds
+   Packed fields are followed by 7 spare bytes so each one is a single
+   8-byte load. Every column is decoded by its own loop over the rows. */
+#define COL_MAGIC "RCOL1\n"
+
+typedef struct {
+    unsigned char *p;
+    size_t n, cap;
+    int oom;
+} col_buf_t;
+
+static int col_reserve(col_buf_t *b, size_t more) {
+    if (b->n + more <= b->cap) return 1;
+    size_t cap = b->cap ? b->cap : 4096;
+    while (cap < b->n + more) cap *= 2;
+    unsigned char *p = realloc(b->p, cap);
+    if (!p) { b->oom = 1; return 0; }
+    b->p = p;
+    b->cap = cap;
+    return 1;
+}
+
+static void col_put(col_buf_t *b, const void *src, size_t len) {
+    if (!col_reserve(b, len)) return;
+    memcpy(b->p + b->n, src, len);
+    b->n += len;
+}
+
+static void col_varint(col_buf_t *b, unsigned long long v) {
+    if (!col_reserve(b, 10)) return;
+    while (v >= 0x80) { b->p[b->n++] = (unsigned char)(v | 0x80); v >>= 7; }
+    b->p[b->n++] = (unsigned char)v;
+}
+
+static unsigned long long col_zig(long long v) { return ((unsigned long long)v << 1) ^ (unsigned long long)(v >> 63); }
+static long long col_unzig(unsigned long long v) { return (long long)(v >> 1) ^ -(long long)(v & 1); }
+
+static int col_width(unsigned max) {
+    int w = 0;
+    while (w < 32 && (max >> w)) ++w;
+    return w;
+}
+
+/* Packs n w-bit values, then the 7 spare bytes. */
+static void col_pack(col_buf_t *b, const unsigned *v, int n, int w) {
+    size_t bytes = ((size_t)n * w + 7) / 8;
+    if (!col_reserve(b, bytes + 7)) return;
+    memset(b->p + b->n, 0, bytes + 7);
+    for (int i = 0; i < n && w; ++i) {
+        size_t bit = (size_t)i * w;
+        unsigned long long word;
+        memcpy(&word, b->p + b->n + bit / 8, 8);
+        word |= (unsigned long long)v[i] << (bit % 8);
+        memcpy(b->p + b->n + bit / 8, &word, 8);
+    }
+    b->n += bytes + 7;
+}
+
+typedef struct {
+    const unsigned char *p, *end;
+    int bad;
+} col_rd_t;
+
+static unsigned long long col_get(col_rd_t *r) {
+    unsigned long long v = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        if (r->p >= r->end) break;
+        unsigned char c = *r->p++;
+        v |= (unsigned long long)(c & 0x7f) << shift;
+        if (!(c & 0x80)) return v;
+    }
+    r->bad = 1;
+    return 0;
+}
+
+/* Unpacks n w-bit values into v; returns 0 if the block overruns. */
+static int col_unpack(col_rd_t *r, unsigned *v, int n, int w) {
+    size_t bytes = ((size_t)n * w + 7) / 8;
+    if (w > 32 || (size_t)(r->end - r->p) < bytes + 7) return 0;
+    const unsigned char *base = r->p;
+    unsigned long long mask = (1ULL << w) - 1;
+    if (!w) memset(v, 0, sizeof(unsigned) * (size_t)n);
+    for (int i = 0; i < n && w; ++i) {
+        size_t bit = (size_t)i * w;
+        unsigned long long word;
+        memcpy(&word, base + bit / 8, 8);
+        v[i] = (unsigned)((word >> (bit % 8)) & mask);
+    }
+    r->p += bytes + 7;
+    return 1;
+}
+
+/* Encodes n tasks (reordered by deadline) into *out; returns 0 on failure. */
+static int col_encode(task_t *t, int n, col_buf_t *out) {
+    unsigned *code = malloc(sizeof(unsigned) * ((size_t)n + 1));
+    int dcap = 16, *dict = malloc(sizeof(int) * dcap), nd = 0;
+    int hbits = col_width((unsigned)n) + 1, *hash = malloc(sizeof(int) << hbits);
+    if (!code || !dict || !hash) { free(code); free(dict); free(hash); return 0; }
+    qsort(t, (size_t)n, sizeof(task_t), cmp_deadline);
+    col_put(out, COL_MAGIC, strlen(COL_MAGIC));
+    col_varint(out, (unsigned long long)n);
+    for (int i = 0; i < n; ++i)
+        col_varint(out, i ? (unsigned long long)(t[i].deadline - t[i - 1].deadline) : col_zig(t[i].deadline));
+    for (int i = 0; i < n; ++i)
+        col_varint(out, col_zig((long long)t[i].id - (i ? t[i - 1].id : 0)));
+    int pmin = INT_MAX, pmax = INT_MIN;
+    for (int i = 0; i < n; ++i) {
+        if (t[i].priority < pmin) pmin = t[i].priority;
+        if (t[i].priority > pmax) pmax = t[i].priority;
+    }
+    int w = n ? col_width((unsigned)((long long)pmax - pmin)) : 0;
+    for (int i = 0; i < n; ++i) code[i] = (unsigned)((long long)t[i].priority - pmin);
+    col_varint(out, col_zig(n ? pmin : 0));
+    col_varint(out, (unsigned long long)w);
+    col_pack(out, code, n, w);
+
+    /* Categories: FNV-1a into an open table of row indexes of first use. */
+    unsigned hmask = (1u << hbits) - 1;
+    memset(hash, -1, sizeof(int) << hbits);
+    for (int i = 0; i < n; ++i) {
+        unsigned h = 2166136261u;
+        for (const char *c = t[i].category; *c; ++c) h = (h ^ (unsigned char)*c) * 16777619u;
+        for (h &= hmask; hash[h] >= 0 && strcmp(t[dict[hash[h]]].category, t[i].category) != 0; h = (h + 1) & hmask)
+            ;
+        if (hash[h] < 0) {
+            if (nd == dcap) {
+                int *p = realloc(dict, sizeof(int) * (dcap *= 2));
+                if (!p) { free(code); free(dict); free(hash); return 0; }
+                dict = p;
+            }
+            hash[h] = nd;
+            dict[nd++] = i;
+        }
+        code[i] = (unsigned)hash[h];
+    }
+    col_varint(out, (unsigned long long)nd);
+    for (int k = 0; k < nd; ++k) {
+        size_t len = strlen(t[dict[k]].category);
+        col_varint(out, len);
+        col_put(out, t[dict[k]].category, len);
+    }
+    w = col_width(nd ? (unsigned)nd - 1 : 0);
+    col_pack(out, code, n, w);
+
+    for (int i = 0; i < n; ++i) col_varint(out, strlen(t[i].title));
+    for (int i = 0; i < n; ++i) col_put(out, t[i].title, strlen(t[i].title));
+
+    int extras = 0, prev = 0;
+    for (int i = 0; i < n; ++i) extras += t[i].after[0] || t[i].lead[0];
+    col_varint(out, (unsigned long long)extras);
+    for (int i = 0; i < n; ++i) {
+        if (!t[i].after[0] && !t[i].lead[0]) continue;
+        int na = 0, nl = 0;
+        while (na < TASK_DEPS && t[i].after[na]) ++na;
+        while (nl < TASK_LEADS && t[i].lead[nl]) ++nl;
+        col_varint(out, (unsigned long long)(i - prev));
+        prev = i;
+        col_varint(out, (unsigned long long)na);
+        for (int k = 0; k < na; ++k) col_varint(out, (unsigned long long)t[i].after[k]);
+        col_varint(out, (unsigned long long)nl);
+        for (int k = 0; k < nl; ++k) col_varint(out, (unsigned long long)t[i].lead[k]);
+    }
+    free(code);
+    free(dict);
+    free(hash);
+    return !out->oom;
+}
+
+/* Decodes a .col image into a fresh array (*out); returns the number of
+   tasks or -1 if it is malformed. user and the store positions are left
+   for the caller. */
+static int col_decode(const unsigned char *p, size_t len, task_t **out) {
+    col_rd_t r = { p, p + len, 0 };
+    *out = NULL;
+    size_t ml = strlen(COL_MAGIC);
+    if (len < ml || memcmp(p, COL_MAGIC, ml) != 0) return -1;
+    r.p += ml;
+    unsigned long long n = col_get(&r);
+    if (r.bad || n > (unsigned long long)(r.end - r.p)) return -1;
+    task_t *t = calloc((size_t)n + 1, sizeof(task_t));
+    unsigned *code = malloc(sizeof(unsigned) * ((size_t)n + 1));
+    size_t *tlen = malloc(sizeof(size_t) * ((size_t)n + 1));
+    const unsigned char **dict = NULL;
+    size_t *dlen = NULL;
+    if (!t || !code || !tlen) goto bad;
+
+    long long acc = 0;
+    for (size_t i = 0; i < n; ++i) {
+        unsigned long long v = col_get(&r);
+        acc = i ? acc + (long long)v : col_unzig(v);
+        t[i].deadline = (time_t)acc;
+    }
+    acc = 0;
+    for (size_t i = 0; i < n; ++i) {
+        acc += col_unzig(col_get(&r));
+        t[i].id = (int)acc;
+    }
+    long long pmin = col_unzig(col_get(&r));
+    int w = (int)col_get(&r);
+    if (r.bad || !col_unpack(&r, code, (int)n, w)) goto bad;
+    for (size_t i = 0; i < n; ++i) t[i].priority = (int)(pmin + code[i]);
+
+    unsigned long long nd = col_get(&r);
+    if (r.bad || nd > n + 1) goto bad;
+    dict = malloc(sizeof(*dict) * (nd + 1));
+    dlen = malloc(sizeof(*dlen) * (nd + 1));
+    if (!dict || !dlen) goto bad;
+    for (size_t k = 0; k < nd; ++k) {
+        dlen[k] = (size_t)col_get(&r);
+        if (r.bad || dlen[k] > (size_t)(r.end - r.p)) goto bad;
+        dict[k] = r.p;
+        r.p += dlen[k];
+        if (dlen[k] >= sizeof(t[0].category)) dlen[k] = sizeof(t[0].category) - 1;
+    }
+    w = col_width(nd ? (unsigned)nd - 1 : 0);
+    if (!col_unpack(&r, code, (int)n, w)) goto bad;
+    for (size_t i = 0; i < n; ++i) {
+        if (code[i] >= nd) goto bad;
+        memcpy(t[i].category, dict[code[i]], dlen[code[i]]);
+    }
+
+    size_t blob = 0;
+    for (size_t i = 0; i < n; ++i) blob += tlen[i] = (size_t)col_get(&r);
+    if (r.bad || blob > (size_t)(r.end - r.p)) goto bad;
+    for (size_t i = 0; i < n; ++i) {
+        size_t keep = tlen[i] < sizeof(t[0].title) ? tlen[i] : sizeof(t[0].title) - 1;
+        memcpy(t[i].title, r.p, keep);
+        r.p += tlen[i];
+    }
+
+    unsigned long long extras = col_get(&r);
+    size_t row = 0;
+    for (unsigned long long e = 0; e < extras && !r.bad; ++e) {
+        row += (size_t)col_get(&r);
+        if (row >= n) goto bad;
+        unsigned long long na = col_get(&r);
+        for (unsigned long long k = 0; k < na && !r.bad; ++k) {
+            unsigned long long v = col_get(&r);
+            if (k < TASK_DEPS) t[row].after[k] = (int)v;
+        }
+        unsigned long long nl = col_get(&r);
+        for (unsigned long long k = 0; k < nl && !r.bad; ++k) {
+            unsigned long long v = col_get(&r);
+            if (k < TASK_LEADS) t[row].lead[k] = (int)v;
+        }
+    }
+    if (r.bad) goto bad;
+    free(code); free(tlen); free(dict); free(dlen);
+    *out = t;
+    return (int)n;
+bad:
+    free(t); free(code); free(tlen); free(dict); free(dlen);
+    return -1;
+}
+
+/* Maps and decodes path; returns the task count, -1 if unreadable. */
+static int col_read(const char *path, task_t **out) {
+    int fd = open(path, O_RDONLY);
+    struct stat st;
+    *out = NULL;
+    if (fd < 0) return -1;
+    if (fstat(fd, &st) != 0 || st.st_size == 0) { close(fd); return -1; }
+    void *map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) return -1;
+    int n = col_decode(map, (size_t)st.st_size, out);
+    munmap(map, (size_t)st.st_size);
+    return n;
+}
+
+/* Applies a .col file to user u like a tasks file; caller holds every
+   shard lock. Returns its size. */
+static long long load_col_file(int u, const char *path) {
+    task_t *t;
+    struct stat st;
+    int n = col_read(path, &t);
+    for (int i = 0; i < n; ++i) {
+        t[i].user = u;
+        shard_upsert_locked(shard_for(task_key(u, t[i].id)), &t[i]);
+    }
+    free(t);
+    return n >= 0 && stat(path, &st) == 0 ? (long long)st.st_size : 0;
+}
+
+/* Reads a text tasks file into a fresh array; returns the count, -1 if unreadable. */
+static int col_read_text(const char *path, task_t **out) {
+    FILE *f = fopen(path, "r");
+    int n = 0, cap = 0;
+    *out = NULL;
+    if (!f) return -1;
+    char line[LINE_BUF];
+    while (fgets(line, sizeof(line), f)) {
+        char *nl = strchr(line, '\n'); if (nl) *nl = 0;
+        if (n == cap) {
+            task_t *p = realloc(*out, sizeof(task_t) * (cap = cap ? cap * 2 : 1024));
+            if (!p) { fclose(f); free(*out); *out = NULL; return -1; }
+            *out = p;
+        }
+        memset(&(*out)[n], 0, sizeof(task_t));
+        if (parse_task_line(line, &(*out)[n])) ++n;
+    }
+    fclose(f);
+    return n;
+}
+
+/* Writes the .col form of text file txt to dst. Returns the bytes
+   written, -1 on failure. */
+static long long col_write(const char *txt, const char *dst) {
+    task_t *t;
+    int n = col_read_text(txt, &t);
+    if (n < 0) return -1;
+    col_buf_t b = { 0 };
+    int fd = -1, ok = col_encode(t, n, &b) && (fd = open(dst, O_WRONLY | O_CREAT | O_TRUNC, 0644)) >= 0;
+    for (size_t off = 0; ok && off < b.n; ) {
+        ssize_t r = write(fd, b.p + off, b.n - off);
+        if (r < 0 && errno == EINTR) continue;
+        if (r < 0) ok = 0;
+        else off += (size_t)r;
+    }
+    if ((fd >= 0 && close(fd) != 0) || !ok) { perror(dst); unlink(dst); ok = 0; }
+    free(t);
+    free(b.p);
+    return ok ? (long long)b.n : -1;
+}
+
+/* Adds or replaces user u's task from a record, or with drop set removes
+   the id rec starts with. With lock set it takes the shard lock itself,
+   otherwise the caller holds every shard lock. */
+static void apply_record(int u, char *rec, int drop, int lock) {
+    task_t t;
+    long long id;
+    if (drop ? !take_number(rec, &id) || id < INT_MIN || id > INT_MAX : !parse_task_line(rec, &t)) return;
+    if (!drop) t.user = u;
+    long long key = task_key(u, drop ? (int)id : t.id);
+    shard_t *s = shard_for(key);
+    if (lock) shard_lock(s);
+    if (drop) {
+        int i = idmap_find(s, key);
+        if (i >= 0) shard_remove_slot(s, s->id_slots[i]);
+    } else {
+        shard_upsert_locked(s, &t);
+    }
+    if (lock) shard_unlock(s);
+}
+
+/* Applies a tasks file or journal for user u; caller holds every shard
+   lock. A journal is replayed only up to its first time marker past until
+   (us, 0 = all), and then -1 is returned; otherwise the bytes read. */
+static long long load_user_file(int u, const char *path, int journal, long long until) {
+    FILE *f = fopen(path, "r");
+    if (!f) return 0;
+    long long bytes = 0;
+    char line[LINE_BUF];
+    while (fgets(line, sizeof(line), f)) {
+        bytes += (long long)strlen(line);
+        char *nl = strchr(line, '\n'); if (nl) *nl = 0;
+        char *rec = line;
+        int drop = 0;
+        if (journal) {
+            long long at;
+            if (line[0] == '@' && line[1] == '|' && until && take_number(line + 2, &at) && at > until) {
+                bytes = -1;
+                break;
+            }
+            if ((line[0] != '+' && line[0] != '-') || line[1] != '|') continue;
+            drop = line[0] == '-';
+            rec = line + 2;
+        }
+        apply_record(u, rec, drop, 0);
+    }
+    fclose(f);
+    return bytes;
+}
+
+/* Applies one partition of user u through a read-only mapping; caller
+   holds every shard lock. With merge set only ids not in the store are
+   added, so a cold partition joins without undoing changes made since.
+   Returns its size. */
+static long long load_part_file(int u, const char *path, int merge) {
+    int fd = open(path, O_RDONLY);
+    struct stat st;
+    if (fd < 0) return 0;
+    if (fstat(fd, &st) != 0 || st.st_size == 0) { close(fd); return 0; }
+    char *map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) { perror(path); return 0; }
+    madvise(map, (size_t)st.st_size, MADV_SEQUENTIAL);
+    char line[LINE_BUF];
+    for (const char *p = map, *end = map + st.st_size; p < end; ) {
+        const char *nl = memchr(p, '\n', (size_t)(end - p));
+        size_t len = (size_t)((nl ? nl : end) - p);
+        if (len >= sizeof(line)) len = sizeof(line) - 1;
+        memcpy(line, p, len);
+        line[len] = 0;
+        p = nl ? nl + 1 : end;
+        task_t t;
+        if (!merge) {
+            apply_record(u, line, 0, 0);
+        } else if (parse_task_line(line, &t)) {
+            t.user = u;
+            shard_t *s = shard_for(task_key(u, t.id));
+            if (idmap_find(s, task_key(u, t.id)) < 0) shard_put_locked(s, &t);
+        }
+    }
+    munmap(map, (size_t)st.st_size);
+    return (long long)st.st_size;
+}
+
+/* Loads the partitions in dir (u's own or a history snapshot), leaving
+   periods after last cold; caller holds every shard lock. Quiet loads
+   mark nothing dirty. Returns the bytes read. */
+static long long load_part_dir(int u, const char *dir, int last, int quiet) {
+    char pattern[PATH_MAX + 8];
+    long long bytes = 0;
+    glob_t g;
+    snprintf(pattern, sizeof(pattern), "%s/*.txt", dir);
+    int rc = glob(pattern, 0, NULL, &g);
+    snprintf(pattern, sizeof(pattern), "%s/*.col", dir);     /* archived snapshots */
+    if (glob(pattern, rc == 0 ? GLOB_APPEND : 0, NULL, &g) == 0 || rc == 0) {
+        part_quiet = quiet;
+        for (size_t i = 0; i < g.gl_pathc; ++i) {
+            const char *path = g.gl_pathv[i];
+            int id = part_mode ? part_parse(path) : 0;
+            if (id == INT_MIN) continue;
+            if (id > last) part_add(&part_cold[u], id);
+            else if (strcmp(path + strlen(path) - 4, ".col") == 0) bytes += load_col_file(u, path);
+            else bytes += load_part_file(u, path, 0);
+        }
+        part_quiet = 0;
+        globfree(&g);
+    }
+    snprintf(pattern, sizeof(pattern), "%s/next", dir);
+    FILE *f = fopen(pattern, "r");
+    int next;
+    if (f) {
+        if (fscanf(f, "%d", &next) == 1 && next > 1) next_id_at_least(&users[u], next - 1);
+        fclose(f);
+    }
+    return bytes;
+}
+
+/* Brings cold partition id of u into the store; caller holds every shard lock. */
+static void part_load_locked(int u, int id) {
+    char path[PATH_MAX + 32];
+    part_path(u, id, path, sizeof(path));
+    part_quiet = 1;
+    __atomic_add_fetch(&users[u].base_bytes, load_part_file(u, path, 1), __ATOMIC_RELAXED);
+    part_quiet = 0;
+    part_forget(&part_cold[u], id);
+}
+
+/* Brings in u's cold partitions that can hold deadlines in [from, to)
+   (0 = open), for lookups that must see every task; caller holds every
+   shard lock and rebuilds dependencies if it returns nonzero. Returns the
+   number of partitions loaded. */
+static int part_thaw_locked(int u, time_t from, time_t to) {
+    int lo = from ? part_of(from) : INT_MIN, hi = to ? part_of(to - 1) : INT_MAX, n = 0;
+    for (int i = part_cold[u].n - 1; i >= 0; --i)
+        if (part_cold[u].ids[i] >= lo && part_cold[u].ids[i] <= hi) {
+            part_load_locked(u, part_cold[u].ids[i]);
+            n++;
+        }
+    return n;
+}
+
+/* Loads all of u's cold partitions; returns 1 if there were any, so a
+   lookup by id that missed knows to try again. */
+int part_thaw(int u) {
+    if (!part_horizon) return 0;
+    store_lock_all();
+    int n = part_thaw_locked(u, 0, 0);
+    if (n) deps_rebuild_locked();
+    store_unlock_all();
+    return n > 0;
+}
+
+/* A loaded task may wait on one in a cold partition: load the rest of that
+   user's partitions so the edge is not lost. Caller holds every shard lock. */
+static void part_thaw_deps_locked(void) {
+    if (!part_horizon) return;
+    for (int si = 0; si < nshards; ++si)
+        for (int i = 0; i < shards[si].count; ++i) {
+            const task_t *t = &shards[si].tasks[i];
+            if (!part_cold[t->user].n) continue;
+            for (int k = 0; k < TASK_DEPS && t->after[k]; ++k) {
+                long long pre = task_key(t->user, t->after[k]);
+                if (idmap_find(shard_for(pre), pre) < 0) { part_thaw_locked(t->user, 0, 0); break; }
+            }
+        }
+}
+
+/* Reads u's cold partitions without loading them, for listings; returns a
+   fresh array in deadline order (*n tasks). */
+task_t *part_cold_tasks(int u, int *n) {
+    task_t *all = NULL;
+    int *ids = NULL, nids = 0;
+    *n = 0;
+    if (!part_horizon) return NULL;
+    store_lock_all();
+    if (part_cold[u].n && (ids = malloc(sizeof(int) * part_cold[u].n)))
+        memcpy(ids, part_cold[u].ids, sizeof(int) * (nids = part_cold[u].n));
+    store_unlock_all();
+    for (int i = 0; i < nids; ++i) {
+        char path[PATH_MAX + 32];
+        task_t *t;
+        part_path(u, ids[i], path, sizeof(path));
+        int k = col_read_text(path, &t);
+        task_t *p = k > 0 ? realloc(all, sizeof(task_t) * (*n + k)) : NULL;
+        if (p) {
+            all = p;
+            for (int j = 0; j < k; ++j) {
+                t[j].user = u;
+                t[j].heap_pos = t[j].after[0] ? -1 : 0;
+            }
+            memcpy(all + *n, t, sizeof(task_t) * k);
+            *n += k;
+        }
+        free(t);
+    }
+    free(ids);
+    if (*n > 1) qsort(all, *n, sizeof(task_t), cmp_deadline);
+    return all;
+}
+
+/* Marks every partition u has on disk dirty, for when the store no longer
+   matches them as a whole. */
+static void part_mark_disk(int u) {
+    char pattern[PATH_MAX + 8];
+    glob_t g;
+    part_dir(u, pattern, sizeof(pattern));
+    snprintf(pattern + strlen(pattern), sizeof(pattern) - strlen(pattern), "/*.txt");
+    if (glob(pattern, 0, NULL, &g) != 0) return;
+    pthread_mutex_lock(&part_mutex);
+    for (size_t i = 0; i < g.gl_pathc; ++i) {
+        int id = part_parse(g.gl_pathv[i]);
+        if (id != INT_MIN) part_add(&part_dirty[u], id);
+    }
+    pthread_mutex_unlock(&part_mutex);
+    globfree(&g);
+}
+
+/* Timer job at each period start: loads the cold partitions the horizon
+   now reaches, then rearms for the next period. */
+static void part_advance(void *arg) {
+    int last = arg ? INT_MAX : part_of(clk->now()) + part_horizon, cold = 0;
+    store_lock_all();
+    for (int u = 0; u < nusers; ++u) {
+        for (int i = part_cold[u].n - 1; i >= 0; --i)
+            if (part_cold[u].ids[i] <= last) part_load_locked(u, part_cold[u].ids[i]);
+        cold += part_cold[u].n;
+    }
+    part_thaw_deps_locked();
+    deps_rebuild_locked();
+    store_unlock_all();
+    if (!cold) return;
+    time_t next = local_to_utc(part_start_days(part_of(clk->now()) + 1) * 86400);
+    timer_at(next, part_advance, NULL);
+}
+
+/* Starts advancing the horizon once the executor runs; without workers
+   there are no timers, so everything is loaded now. */
+void part_watch(void) {
+    if (part_mode == PART_OFF || !part_horizon) return;
+    part_advance(nworkers ? NULL : (void *)1);
+}
+
+void load_tasks() {
+    if (!task_file) return;
+    TRACE_BEGIN(t0);
+    users_discover();
+    store_lock_all();
+    store_clear_locked(0);
+    for (int u = 0; u < nusers; ++u) {
+        char path[PATH_MAX], dir[PATH_MAX], jpath[PATH_MAX];
+        struct stat st;
+        user_file(u, path, sizeof(path));
+        part_dir(u, dir, sizeof(dir));
+        journal_path(u, jpath, sizeof(jpath));
+        part_dirty[u].n = part_cold[u].n = 0;
+        if (stat(path, &st) != 0 && stat(dir, &st) == 0) {
+            /* A journal left by a crash may touch any period: load them all. */
+            int all = !part_horizon || access(jpath, F_OK) == 0;
+            users[u].base_bytes = load_part_dir(u, dir, all ? INT_MAX : part_of(clk->now()) + part_horizon, 1);
+        } else {
+            /* One file, or one being split: it is authoritative until the
+               first partitioned checkpoint removes it. */
+            users[u].base_bytes = load_user_file(u, path, 0, 0);
+            if (part_mode) part_mark_disk(u);
+        }
+        users[u].journal_bytes = load_user_file(u, jpath, 1, 0);
+    }
+    part_thaw_deps_locked();
+    deps_rebuild_locked();
+    int n = store_count;
+    store_unlock_all();
+    trace_span("load_tasks", t0, n);
+}
+
+/* --- History ---
+   With REMINDER_HISTORY=<days>, checkpoints keep what they replace. In
+   <file>.history/ each checkpoint at time T (us) leaves
+     seg-T.log   the journal it superseded, i.e. the changes up to T
+     snap-T.txt  a hard link to the new file (files are only ever replaced
+                 by rename, so the link never changes)
+   Checkpoints already come every JOURNAL_SLACK bytes of changes, so
+   snapshots are as frequent as the churn needs. The store as of any time
+   X is the newest snapshot at or before X plus the later segments (and
+   finally the live journal) replayed up to X by their time markers. Files
+   older than the retention are pruned, but the newest snapshot before the
+   cutoff is kept as the base for the span after it. With partitions a
+   snapshot is a directory snap-T/ of links to every partition, so periods
+   that did not change share one copy across all snapshots. Once a later
+   checkpoint leaves a snapshot file the only link to its data, it is
+   archived in the columnar format (snap-T.col, or <period>.col). */
+static void history_dir(int u, char *buf, size_t n) {
+    user_file(u, buf, n);
+    size_t len = strlen(buf);
+    snprintf(buf + len, n - len, ".history");
+}
+
+static int cmp_ll(const void *a, const void *b) {
+    long long x = *(const long long *)a, y = *(const long long *)b;
+    return (x > y) - (x < y);
+}
+
+/* Timestamps of u's snapshots ("snap") or segments ("seg"), ascending;
+   caller frees *out. */
+static int history_list(int u, const char *kind, long long **out) {
+    char dir[PATH_MAX], pattern[PATH_MAX + 16];
+    history_dir(u, dir, sizeof(dir));
+    snprintf(pattern, sizeof(pattern), "%s/%s-*", dir, kind);
+    glob_t g;
+    *out = NULL;
+    if (glob(pattern, 0, NULL, &g) != 0) return 0;
+    int n = 0;
+    *out = malloc(sizeof(long long) * (g.gl_pathc + 1));
+    for (size_t i = 0; *out && i < g.gl_pathc; ++i) {
+        long long ts;
+        if (take_number(strrchr(g.gl_pathv[i], '-') + 1, &ts)) (*out)[n++] = ts;
+    }
+    globfree(&g);
+    qsort(*out, n, sizeof(long long), cmp_ll);
+    return n;
+}
+
+static void history_path(int u, const char *kind, long long ts, char *buf, size_t n) {
+    history_dir(u, buf, n);
+    size_t len = strlen(buf);
+    if (strcmp(kind, "snap") != 0) snprintf(buf + len, n - len, "/%s-%lld.log", kind, ts);
+    else snprintf(buf + len, n - len, part_mode ? "/%s-%lld" : "/%s-%lld.txt", kind, ts);
+}
+
+/* Links file, or with partitions every file in that directory, as path. */
+static void history_link(const char *file, const char *path) {
+    if (!part_mode) {
+        if (link(file, path) != 0) perror(path);
+        return;
+    }
+    char pattern[PATH_MAX + 4], dst[PATH_MAX * 2];
+    glob_t g;
+    if (mkdir(path, 0755) != 0) { perror(path); return; }
+    snprintf(pattern, sizeof(pattern), "%s/*", file);
+    if (glob(pattern, 0, NULL, &g) != 0) return;
+    for (size_t i = 0; i < g.gl_pathc; ++i) {
+        snprintf(dst, sizeof(dst), "%s%s", path, strrchr(g.gl_pathv[i], '/'));
+        if (link(g.gl_pathv[i], dst) != 0) perror(dst);
+    }
+    globfree(&g);
+}
+
+static void history_remove(const char *path) {
+    if (unlink(path) == 0 || errno != EISDIR) return;
+    char pattern[PATH_MAX + 64];
+    glob_t g;
+    snprintf(pattern, sizeof(pattern), "%s/*", path);
+    if (glob(pattern, 0, NULL, &g) == 0) {
+        for (size_t i = 0; i < g.gl_pathc; ++i) unlink(g.gl_pathv[i]);
+        globfree(&g);
+    }
+    rmdir(path);
+}
+
+/* Guards snapshot files changing form against pruning and recovery. */
+static pthread_mutex_t history_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/* Executor job after a checkpoint of user arg (its users[] entry): every
+   snapshot file only the history still holds (link count 1, no longer the
+   live file or shared with a later snapshot) is rewritten as .col. */
+static void history_compact(void *arg) {
+    static pthread_mutex_t compact_mutex = PTHREAD_MUTEX_INITIALIZER;
+    int u = (int)((user_t *)arg - users);
+    char dir[PATH_MAX], pattern[PATH_MAX + 16], col[PATH_MAX + 16], tmp[PATH_MAX + 24];
+    history_dir(u, dir, sizeof(dir));
+    snprintf(pattern, sizeof(pattern), part_mode ? "%s/snap-*/*.txt" : "%s/snap-*.txt", dir);
+    pthread_mutex_lock(&compact_mutex);
+    glob_t g;
+    if (glob(pattern, 0, NULL, &g) != 0) { pthread_mutex_unlock(&compact_mutex); return; }
+    for (size_t i = 0; i < g.gl_pathc; ++i) {
+        const char *txt = g.gl_pathv[i];
+        struct stat st;
+        if (stat(txt, &st) != 0 || st.st_nlink != 1) continue;
+        snprintf(col, sizeof(col), "%.*s.col", (int)strlen(txt) - 4, txt);
+        snprintf(tmp, sizeof(tmp), "%s.tmp", col);
+        long long bytes = col_write(txt, tmp);
+        pthread_mutex_lock(&history_mutex);
+        /* Pruning may have taken the snapshot meanwhile. */
+        if (bytes >= 0 && access(txt, F_OK) == 0 && rename(tmp, col) == 0) {
+            unlink(txt);
+            METRIC_ADD(archive_text_bytes, st.st_size);
+            METRIC_ADD(archive_col_bytes, bytes);
+        } else {
+            unlink(tmp);
+        }
+        pthread_mutex_unlock(&history_mutex);
+    }
+    globfree(&g);
+    pthread_mutex_unlock(&compact_mutex);
+}
+
+/* Called by a checkpoint with every shard locked: file is u's new tasks
+   file (or partition directory), journal the one it supersedes. */
+static void history_archive(int u, const char *file, const char *journal) {
+    char dir[PATH_MAX], path[PATH_MAX + 48];
+    long long now = (long long)(clock_now_precise() * 1e6);
+    history_dir(u, dir, sizeof(dir));
+    if (mkdir(dir, 0755) != 0 && errno != EEXIST) { perror(dir); unlink(journal); return; }
+    history_path(u, "seg", now, path, sizeof(path));
+    if (rename(journal, path) != 0 && errno != ENOENT) perror(path);
+    history_path(u, "snap", now, path, sizeof(path));
+    history_link(file, path);
+
+    long long *snaps, *segs, base = 0;
+    pthread_mutex_lock(&history_mutex);
+    int ns = history_list(u, "snap", &snaps), ng = history_list(u, "seg", &segs);
+    for (int i = 0; i < ns && snaps[i] <= now - history_keep_us; ++i) base = snaps[i];
+    for (int i = 0; i < ns && snaps[i] < base; ++i) {
+        history_path(u, "snap", snaps[i], path, sizeof(path));
+        history_remove(path);
+        if (!part_mode) { strcpy(path + strlen(path) - 3, "col"); unlink(path); }
+    }
+    for (int i = 0; i < ng && segs[i] <= base; ++i) {
+        history_path(u, "seg", segs[i], path, sizeof(path));
+        unlink(path);
+    }
+    pthread_mutex_unlock(&history_mutex);
+    free(snaps);
+    free(segs);
+    /* Only in the background: inline it would hold every shard lock. Each
+       run sweeps all snapshots, so one skipped here is picked up later. */
+    if (nworkers) executor_submit(history_compact, &users[u]);
+}
+
+void history_config(void) {
+    const char *p = getenv("REMINDER_HISTORY");
+    if (p && atof(p) > 0) history_keep_us = (long long)(atof(p) * 86400e6);
+}
+
+static void save_user(int u);
+
+/* Rebuilds user u's tasks as they were at `at` (us) from the history and
+   makes that the current state, checkpointed (so the state it replaces
+   stays recoverable) and shipped to an attached standby. Returns the
+   number of tasks, -1 if no snapshot is old enough. */
+int recover_user(int u, long long at) {
+    TRACE_BEGIN(t0);
+    long long *snaps, *segs, base = -1;
+    int ns = history_list(u, "snap", &snaps), ng = history_list(u, "seg", &segs);
+    for (int i = 0; i < ns && snaps[i] <= at; ++i) base = snaps[i];
+    if (base < 0) { free(snaps); free(segs); return -1; }
+    char path[PATH_MAX + 48];
+    store_lock_all();
+    repl_ship_user(u, 1);
+    if (part_mode) {
+        /* The snapshot has every period, cold ones too, and whatever is on
+           disk now is replaced. */
+        part_mark_disk(u);
+        part_cold[u].n = 0;
+    }
+    for (int si = 0; si < nshards; ++si) {
+        shard_t *s = &shards[si];
+        for (int i = s->count - 1; i >= 0; --i)
+            if (s->tasks[i].user == u) shard_remove_slot(s, i);
+    }
+    history_path(u, "snap", base, path, sizeof(path));
+    pthread_mutex_lock(&history_mutex);
+    if (part_mode) load_part_dir(u, path, INT_MAX, 0);
+    else if (access(path, F_OK) == 0) load_user_file(u, path, 0, 0);
+    else { strcpy(path + strlen(path) - 3, "col"); load_col_file(u, path); }
+    pthread_mutex_unlock(&history_mutex);
+    int stopped = 0;
+    for (int i = 0; i < ng && !stopped; ++i) {
+        if (segs[i] <= base) continue;
+        history_path(u, "seg", segs[i], path, sizeof(path));
+        stopped = load_user_file(u, path, 1, at) < 0;
+    }
+    if (!stopped) {
+        journal_path(u, path, sizeof(path));
+        load_user_file(u, path, 1, at);
+    }
+    deps_rebuild_locked();
+    repl_ship_user(u, 0);
+    int n = __atomic_load_n(&users[u].live, __ATOMIC_RELAXED);
+    store_unlock_all();
+    free(snaps);
+    free(segs);
+    save_user(u);
+    trace_span("recover", t0, n);
+    return n;
+}
+
+/* After u's state reached file: closes the journal it supersedes and
+   removes (or archives) it. Caller holds every shard lock. */
+static void checkpoint_retire(int u, const char *file, long long bytes) {
+    char jpath[PATH_MAX];
+    journal_path(u, jpath, sizeof(jpath));
+    int jfd = __atomic_exchange_n(&users[u].journal_fd, -1, __ATOMIC_ACQ_REL);
+    if (jfd >= 0) close(jfd);
+    if (history_keep_us) history_archive(u, file, jpath);
+    else unlink(jpath);
+    __atomic_store_n(&users[u].journal_bytes, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&users[u].base_bytes, bytes, __ATOMIC_RELAXED);
+}
+
+#define PART_BATCH 64    /* partitions written per pass over the store */
+
+/* Partitioned checkpoint: rewrites only the periods changed since the last
+   one, each through its own temporary file, and drops those left empty. A
+   crash part way leaves some periods new and some old; the journal,
+   retired only after the last rename, replays over either. */
+static void save_user_parts(int u) {
+    TRACE_BEGIN(t0);
+    static pthread_mutex_t save_mutex = PTHREAD_MUTEX_INITIALIZER;
+    char dir[PATH_MAX], path[PATH_MAX + 32], tmp[PATH_MAX + 36], rec[RECORD_MAX];
+    part_dir(u, dir, sizeof(dir));
+    pthread_mutex_lock(&save_mutex);
+    if (mkdir(dir, 0755) != 0 && errno != EEXIST) {
+        perror(dir);
+        pthread_mutex_unlock(&save_mutex);
+        return;
+    }
+    store_lock_all();
+    pthread_mutex_lock(&part_mutex);
+    part_set_t dirty = part_dirty[u];
+    memset(&part_dirty[u], 0, sizeof(dirty));
+    pthread_mutex_unlock(&part_mutex);
+    int merged = 0;
+    for (int i = 0; i < dirty.n; ++i)
+        if (part_has(&part_cold[u], dirty.ids[i])) { part_load_locked(u, dirty.ids[i]); merged = 1; }
+    if (merged) deps_rebuild_locked();
+
+    int ok = 1;
+    long long bytes = 0;
+    for (int b = 0; b < dirty.n; b += PART_BATCH) {
+        int nb = dirty.n - b < PART_BATCH ? dirty.n - b : PART_BATCH;
+        FILE *f[PART_BATCH] = { 0 };
+        long long sz[PART_BATCH] = { 0 };
+        for (int k = 0; k < nb && ok; ++k) {
+            part_path(u, dirty.ids[b + k], path, sizeof(path));
+            snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+            if (!(f[k] = fopen(tmp, "w"))) { perror(tmp); ok = 0; }
+        }
+        for (int si = 0; si < nshards && ok; ++si) {
+            shard_t *s = &shards[si];
+            for (int i = 0; i < s->count; ++i) {
+                if (s->tasks[i].user != u) continue;
+                int id = part_of(s->tasks[i].deadline), k = 0;
+                while (k < nb && dirty.ids[b + k] != id) ++k;
+                if (k == nb) continue;
+                size_t len = (size_t)(serialize_task(rec, &s->tasks[i]) - rec);
+                fwrite(rec, 1, len, f[k]);
+                sz[k] += (long long)len;
+            }
+        }
+        for (int k = 0; k < nb; ++k) {
+            if (!f[k]) continue;
+            part_path(u, dirty.ids[b + k], path, sizeof(path));
+            snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+            if (ferror(f[k]) | (fclose(f[k]) != 0) || !ok) { perror(tmp); ok = 0; unlink(tmp); }
+            else if (sz[k] == 0) { unlink(tmp); unlink(path); }
+            else if (rename(tmp, path) != 0) { perror(path); ok = 0; unlink(tmp); }
+            else bytes += sz[k];
+        }
+    }
+    if (ok) {
+        snprintf(path, sizeof(path), "%s/next", dir);
+        snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+        FILE *nf = fopen(tmp, "w");
+        ok = nf && fprintf(nf, "%d\n", __atomic_load_n(&users[u].next_id, __ATOMIC_RELAXED)) > 0;
+        if ((nf && fclose(nf) != 0) || !ok || rename(tmp, path) != 0) { perror(path); ok = 0; unlink(tmp); }
+    }
+    if (ok) {
+        user_file(u, path, sizeof(path));
+        unlink(path);              /* the single file this replaced, if any */
+        long long total = 0;
+        glob_t g;
+        snprintf(path, sizeof(path), "%s/*.txt", dir);
+        if (glob(path, 0, NULL, &g) == 0) {
+            struct stat st;
+            for (size_t i = 0; i < g.gl_pathc; ++i)
+                if (stat(g.gl_pathv[i], &st) == 0) total += st.st_size;
+            globfree(&g);
+        }
+        checkpoint_retire(u, dir, total);
+    } else {
+        /* Everything stays dirty for the next checkpoint to retry. */
+        pthread_mutex_lock(&part_mutex);
+        for (int i = 0; i < dirty.n; ++i) part_add(&part_dirty[u], dirty.ids[i]);
+        pthread_mutex_unlock(&part_mutex);
+    }
+    free(dirty.ids);
+    int n = __atomic_load_n(&users[u].live, __ATOMIC_RELAXED);
+    store_unlock_all();
+    pthread_mutex_unlock(&save_mutex);
+    METRIC_ADD(saves, 1);
+    if (bytes > 0) { METRIC_ADD(save_bytes, bytes); METRIC_SET(last_save_bytes, bytes); }
+    trace_span("save_tasks", t0, n);
+}
+
+/* Checkpoint: writes u's tasks to a temporary file, renames it over the old
+   one, then removes (or archives) the journal it supersedes. Records go out
+   shard by shard in slot order; loading does not depend on their order. */
+static void save_user(int u) {
+    if (part_mode) { save_user_parts(u); return; }
+    TRACE_BEGIN(t0);
+    /* Shard schedulers can save concurrently; one writer at a time. */
+    static char *buf;
+    static pthread_mutex_t save_mutex = PTHREAD_MUTEX_INITIALIZER;
+    char path[PATH_MAX], tmp[PATH_MAX + 4];
+    user_file(u, path, sizeof(path));
+    snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+    pthread_mutex_lock(&save_mutex);
+    int fd = open(tmp, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0 || (!buf && !(buf = malloc(SAVE_BUF)))) {
+        perror("save_tasks");
+        if (fd >= 0) close(fd);
+        pthread_mutex_unlock(&save_mutex);
+        return;
+    }
+    store_lock_all();
+    long bytes = 0;
+    char *p = buf;
+    for (int si = 0; si < nshards && bytes >= 0; ++si) {
+        shard_t *s = &shards[si];
+        for (int i = 0; i <= s->count; ++i) {
+            int last = si == nshards - 1 && i == s->count;
+            if (last || p - buf > SAVE_BUF - RECORD_MAX) {
+                for (char *w = buf; w < p; ) {
+                    ssize_t r = write(fd, w, (size_t)(p - w));
+                    if (r < 0) { if (errno == EINTR) continue; perror("save_tasks"); bytes = -1; break; }
+                    w += r;
+                }
+                if (bytes < 0) break;
+                bytes += p - buf;
+                p = buf;
+            }
+            if (i < s->count && s->tasks[i].user == u) p = serialize_task(p, &s->tasks[i]);
+        }
+    }
+    int n = __atomic_load_n(&users[u].live, __ATOMIC_RELAXED);
+    if (close(fd) != 0 || bytes < 0 || rename(tmp, path) != 0) {
+        perror(path);
+        unlink(tmp);
+    } else {
+        checkpoint_retire(u, path, bytes);
+    }
+    store_unlock_all();
+    pthread_mutex_unlock(&save_mutex);
+    METRIC_ADD(saves, 1);
+    if (bytes > 0) { METRIC_ADD(save_bytes, bytes); METRIC_SET(last_save_bytes, bytes); }
+    trace_span("save_tasks", t0, n);
+}
+
+static int journal_over(int u) {
+    return __atomic_load_n(&users[u].journal_bytes, __ATOMIC_RELAXED) >
+           __atomic_load_n(&users[u].base_bytes, __ATOMIC_RELAXED) + JOURNAL_SLACK;
+}
+
+/* Checkpoints every user whose journal outgrew its file, or all users. */
+void save_users(int all) {
+    if (!task_file) return;
+    for (int u = 0; u < nusers; ++u)
+        if (all || journal_over(u)) save_user(u);
+}
+
+static int checkpoint_queued;    /* a save_users(0) job is pending (atomic) */
+
+static void checkpoint_job(void *arg) {
+    (void)arg;
+    __atomic_store_n(&checkpoint_queued, 0, __ATOMIC_RELEASE);
+    save_users(0);
+}
+
+/* For the schedulers: fired tasks are already durable in the journal, so
+   a checkpoint is needed only past the threshold, and then runs on a
+   worker instead of stalling this shard's scheduler on file I/O. */
+void save_users_background(void) {
+    if (!task_file) return;
+    for (int u = 0; u < nusers; ++u)
+        if (journal_over(u)) {
+            if (!__atomic_exchange_n(&checkpoint_queued, 1, __ATOMIC_ACQ_REL)) executor_submit(checkpoint_job, NULL);
+            return;
+        }
+}
+
+void save_tasks() { save_users(1); }
+
+/* Insert into user's namespace with early reminders lead (0-terminated,
+   NULL = none), all in one journal record; returns the new id or -1 when
+   the store or the user's quota is full. */
+int insert_task_leads(int user, const char *title, const char *category, int priority, time_t deadline,
+                      const int *lead) {
+    task_t t;
+    memset(&t, 0, sizeof(t));
+    if (lead) memcpy(t.lead, lead, sizeof(t.lead));
+    t.user = user;
+    t.id = __atomic_fetch_add(&users[user].next_id, 1, __ATOMIC_RELAXED);
+    strncpy(t.title, title, sizeof(t.title)-1);
+    strncpy(t.category, category, sizeof(t.category)-1);
+    t.priority = priority;
+    t.deadline = deadline;
+    return store_put(&t) ? t.id : -1;
+}
+
+int insert_task(int user, const char *title, const char *category, int priority, time_t deadline) {
+    return insert_task_leads(user, title, category, priority, deadline, NULL);
+}
+
+/* Remove user's task id; returns 1 if found. */
+int remove_task(int user, int id) {
+    long long key = task_key(user, id);
+    shard_t *s = shard_for(key);
+    shard_lock(s);
+    int i = idmap_find(s, key);
+    task_t gone;
+    if (i >= 0) {
+        gone = s->tasks[s->id_slots[i]];
+        shard_remove_slot(s, s->id_slots[i]);
+        journal_drop(&gone, 1);
+    }
+    shard_unlock(s);
+    if (i >= 0) deps_done(&gone, 1);
+    else if (part_thaw(user)) return remove_task(user, id);
+    return i >= 0;
+}
+
+/* Copies user's task id into *out; returns 1 if found. */
+int get_task(int user, int id, task_t *out) {
+    long long key = task_key(user, id);
+    shard_t *s = shard_for(key);
+    shard_lock(s);
+    int i = idmap_find(s, key);
+    if (i >= 0) *out = s->tasks[s->id_slots[i]];
+    shard_unlock(s);
+    if (i < 0 && part_thaw(user)) return get_task(user, id, out);
+    return i >= 0;
+}
+
+/* Edits user's task id in place with the fields of src picked by mask
+   (UPD_*); only the new record is journaled. Returns 1 if found. */
+int update_task(int user, int id, const task_t *src, unsigned mask) {
+    long long key = task_key(user, id);
+    shard_t *s = shard_for(key);
+    shard_lock(s);
+    int i = idmap_find(s, key);
+    if (i >= 0) {
+        shard_update_slot(s, s->id_slots[i], src, mask);
+        journal_put(&s->tasks[s->id_slots[i]]);
+    }
+    shard_unlock(s);
+    if (i < 0 && part_thaw(user)) return update_task(user, id, src, mask);
+    return i >= 0;
+}
+
+/* Deletes (remove set) or moves by shift seconds every task matching f,
+   holding the store locks once for the whole pass, and journals the result
+   in one write. Returns the number of tasks affected. */
+int bulk_update(const task_filter_t *f, int remove, long shift) {
+    TRACE_BEGIN(t0);
+    task_t *changed = NULL;
+    int n = 0, cap = 0;
+    store_lock_all();
+    if (part_thaw_locked(f->user, f->from, f->to)) deps_rebuild_locked();
+    for (int si = 0; si < nshards; ++si) {
+        shard_t *s = &shards[si];
+        int *sel = malloc(sizeof(int) * (s->count + 1));
+        int k = sel ? shard_select(s, f, sel) : 0;
+        if (n + k > cap) {
+            cap = n + k;
+            task_t *p = realloc(changed, sizeof(task_t) * cap);
+            if (!p) { free(sel); continue; }
+            changed = p;
+        }
+        time_t top = shard_top(s);
+        if (remove) {
+            /* Highest slot first: swap-remove only ever moves a kept task. */
+            qsort(sel, k, sizeof(int), cmp_int_desc);
+            for (int i = 0; i < k; ++i) {
+                changed[n++] = s->tasks[sel[i]];
+                shard_remove_slot(s, sel[i]);
+            }
+        } else if (k) {
+            /* Many moved: shift all and reheapify once. Few: shift and sift
+               each in turn, so every heap_fix starts from a valid heap. */
+            int rebuild = k > s->heap_n / 8;
+            for (int i = 0; i < k; ++i) {
+                task_t *t = &s->tasks[sel[i]];
+                part_touch(t->user, t->deadline);
+                t->deadline += shift;
+                part_touch(t->user, t->deadline);
+                if (!rebuild && t->heap_pos >= 0) heap_fix(s, t->heap_pos);
+            }
+            if (rebuild)
+                for (int pos = s->heap_n / 2 - 1; pos >= 0; --pos) heap_down(s, pos);
+            for (int i = 0; i < k; ++i) {
+                if (s->tasks[sel[i]].heap_pos >= 0) { trig_disarm(s, sel[i]); trig_arm(s, sel[i]); }
+                changed[n++] = s->tasks[sel[i]];
+            }
+        }
+        if (k && shard_top(s) != top) pthread_cond_signal(&s->wake);
+        free(sel);
+    }
+    if (remove) journal_drop(changed, n);
+    else journal_put_batch(changed, n);
+    store_unlock_all();
+    if (remove) deps_done(changed, n);
+    free(changed);
+    trace_span(remove ? "bulk_delete" : "bulk_reschedule", t0, n);
+    return n;
+}
+
+/* Takes every task due at now from all shards, merged in deadline order
+   (*out, NULL if none). Returns the number taken. Their dependents stay
+   parked: the caller calls deps_done() for the ones it does not put back. */
+int store_take_due(time_t now, task_t **out) {
+    int total = 0;
+    *out = NULL;
+    for (int i = 0; i < nshards; ++i) {
+        task_t *part;
+        shard_lock(&shards[i]);
+        int n = shard_take_due(&shards[i], now, &part);
+        journal_drop(part, n);
+        shard_unlock(&shards[i]);
+        if (!n) continue;
+        task_t *p = realloc(*out, sizeof(task_t) * (total + n));
+        if (!p) { free(part); continue; }
+        *out = p;
+        memcpy(*out + total, part, sizeof(task_t) * n);
+        free(part);
+        total += n;
+    }
+    if (nshards > 1 && total > 1) qsort(*out, total, sizeof(task_t), cmp_deadline);
+    return total;
+}
+
+/* --- Replication ---
+   A primary started with REMINDER_REPLICATE=<socket> listens on a unix
+   socket for one hot standby. On connect the standby gets every user's
+   tasks as "+|" records and a "C" frame, then a copy of each journal_write()
+   in the same order, so for any task it sees the store order:
+     R|user|seq|sent_us|len\n followed by len bytes of journal lines
+     C|seq|sent_us\n       snapshot complete
+     X|reason\n            refused, sent instead of a snapshot when a standby
+                          is already attached
+   Shipping only appends to a buffer under repl_mutex; a sender thread does
+   the socket writes, so shard locks never wait on the standby. The standby
+   never writes back, so a readable socket means it hung up: a connecting
+   standby checks for that before being refused, so a restart while the
+   primary is idle attaches again.
+
+   A standby (REMINDER_STANDBY=<socket>) starts empty, applies each frame as
+   it arrives, journals it to its own files and records how long after
+   sending it was applied. When the connection drops after the "C" frame it
+   takes over at once: dependencies are rebuilt, early reminders the primary
+   already gave are discarded, and startup continues with catch-up and the
+   schedulers. Refused, or cut off before the snapshot completed, it exits
+   instead of serving a partial store. */
+static int repl_fd = -1;               /* connected standby (atomic), -1 if none */
+static int repl_listen_fd = -1;
+static char *repl_buf, *repl_spare;
+static size_t repl_len, repl_cap, repl_spare_cap;
+static unsigned long long repl_seq;
+static int repl_sending;               /* sender is writing to repl_fd unlocked */
+static pthread_mutex_t repl_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t repl_cv = PTHREAD_COND_INITIALIZER;
+
+static int repl_reserve_locked(size_t n) {
+    if (repl_len + n <= repl_cap) return 1;
+    size_t cap = repl_cap ? repl_cap : 64 * 1024;
+    while (cap < repl_len + n) cap *= 2;
+    char *p = realloc(repl_buf, cap);
+    if (!p) return 0;
+    repl_buf = p;
+    repl_cap = cap;
+    return 1;
+}
+
+static long long repl_now_us(void) { return (long long)(clock_now_precise() * 1e6); }
+
+static void repl_frame_locked(int u, const char *buf, size_t len) {
+    char head[96];
+    int h = snprintf(head, sizeof(head), "R|%s|%llu|%lld|%zu\n", users[u].name, ++repl_seq, repl_now_us(), len);
+    if (!repl_reserve_locked((size_t)h + len)) return;
+    memcpy(repl_buf + repl_len, head, (size_t)h);
+    memcpy(repl_buf + repl_len + h, buf, len);
+    repl_len += (size_t)h + len;
+    METRIC_ADD(repl_frames, 1);
+    pthread_cond_signal(&repl_cv);
+}
+
+/* Called by journal_write(), under the lock of the shard that changed. */
+void repl_ship(int u, const char *buf, size_t len) {
+    if (__atomic_load_n(&repl_fd, __ATOMIC_ACQUIRE) < 0) return;
+    pthread_mutex_lock(&repl_mutex);
+    if (repl_fd >= 0) repl_frame_locked(u, buf, len);
+    pthread_mutex_unlock(&repl_mutex);
+}
+
+static void *repl_sender_fn(void *arg) {
+    (void)arg;
+    trace_thread_name("replication");
+    pthread_mutex_lock(&repl_mutex);
+    for (;;) {
+        while (!repl_len) pthread_cond_wait(&repl_cv, &repl_mutex);
+        /* Swap buffers so shipping continues while this one is written. */
+        char *out = repl_buf;
+        size_t n = repl_len, cap = repl_cap;
+        repl_buf = repl_spare; repl_cap = repl_spare_cap;
+        repl_spare = out; repl_spare_cap = cap;
+        repl_len = 0;
+        int fd = repl_fd;
+        repl_sending = 1;
+        pthread_mutex_unlock(&repl_mutex);
+        TRACE_BEGIN(t0);
+        size_t done = 0;
+        while (done < n) {
+            ssize_t r = send(fd, out + done, n - done, MSG_NOSIGNAL);
+            if (r < 0 && errno == EINTR) continue;
+            if (r <= 0) break;
+            done += (size_t)r;
+        }
+        trace_span("replication send", t0, (long long)n);
+        METRIC_ADD(repl_bytes, done);
+        pthread_mutex_lock(&repl_mutex);
+        repl_sending = 0;
+        if (done < n) {
+            fprintf(stderr, "Replication: standby lost (%s).\n", strerror(errno));
+            close(fd);
+            __atomic_store_n(&repl_fd, -1, __ATOMIC_RELEASE);
+            repl_len = 0;
+        }
+    }
+    return NULL;
+}
+
+/* Frames every task of user u, as "+|" records or with drop set as "-|"
+   ones; caller holds every shard lock and repl_mutex. Returns the count. */
+static int repl_user_locked(int u, int drop) {
+    char *chunk = malloc(SAVE_BUF), *p = chunk;
+    int n = 0;
+    if (!chunk) return 0;
+    for (int si = 0; si < nshards; ++si)
+        for (int i = 0; i < shards[si].count; ++i) {
+            const task_t *t = &shards[si].tasks[i];
+            if (t->user != u) continue;
+            if (p - chunk > SAVE_BUF - RECORD_MAX - 2) { repl_frame_locked(u, chunk, (size_t)(p - chunk)); p = chunk; }
+            *p++ = drop ? '-' : '+'; *p++ = '|';
+            if (drop) { p = put_int(p, t->id); *p++ = '\n'; }
+            else p = serialize_task(p, t);
+            n++;
+        }
+    if (p > chunk) repl_frame_locked(u, chunk, (size_t)(p - chunk));
+    free(chunk);
+    return n;
+}
+
+/* Ships all of user u's tasks to the standby, for changes made without the
+   journal (recovery drops them all, then puts the new set); caller holds
+   every shard lock, so the frames keep their place in the stream. */
+void repl_ship_user(int u, int drop) {
+    if (__atomic_load_n(&repl_fd, __ATOMIC_ACQUIRE) < 0) return;
+    pthread_mutex_lock(&repl_mutex);
+    if (repl_fd >= 0) repl_user_locked(u, drop);
+    pthread_mutex_unlock(&repl_mutex);
+}
+
+/* Sends a consistent snapshot and attaches fd as the standby: every shard
+   is locked, so no change can fall between the snapshot and the stream. */
+static void repl_attach(int fd) {
+    store_lock_all();
+    pthread_mutex_lock(&repl_mutex);
+    repl_len = 0;
+    int n = 0;
+    for (int u = 0; u < nusers; ++u) n += repl_user_locked(u, 0);
+    char head[64];
+    int h = snprintf(head, sizeof(head), "C|%llu|%lld\n", ++repl_seq, repl_now_us());
+    if (repl_reserve_locked((size_t)h)) { memcpy(repl_buf + repl_len, head, (size_t)h); repl_len += (size_t)h; }
+    __atomic_store_n(&repl_fd, fd, __ATOMIC_RELEASE);
+    pthread_cond_signal(&repl_cv);
+    pthread_mutex_unlock(&repl_mutex);
+    store_unlock_all();
+    fprintf(stderr, "Replication: standby attached, %d task(s) in snapshot.\n", n);
+}
+
+/* Drops the attached standby if it has hung up while nothing was being
+   sent; returns 1 if one is still attached. */
+static int repl_attached_alive(void) {
+    pthread_mutex_lock(&repl_mutex);
+    struct pollfd p = { repl_fd, POLLIN, 0 };
+    if (repl_fd >= 0 && !repl_sending && poll(&p, 1, 0) > 0) {
+        fprintf(stderr, "Replication: standby hung up.\n");
+        close(repl_fd);
+        __atomic_store_n(&repl_fd, -1, __ATOMIC_RELEASE);
+        repl_len = 0;
+    }
+    int alive = repl_fd >= 0;
+    pthread_mutex_unlock(&repl_mutex);
+    return alive;
+}
+
+static void *repl_accept_fn(void *arg) {
+    (void)arg;
+    for (;;) {
+        int fd = accept(repl_listen_fd, NULL, NULL);
+        if (fd < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) continue;
+            perror("replication accept");
+            return NULL;
+        }
+        if (repl_attached_alive()) {                                   /* one standby */
+            static const char busy[] = "X|another standby is attached\n";
+            if (send(fd, busy, sizeof(busy) - 1, MSG_NOSIGNAL) < 0) perror("replication refuse");
+            close(fd);
+            continue;
+        }
+        repl_attach(fd);
+    }
+}
+
+static int repl_socket(const char *path, struct sockaddr_un *addr) {
+    memset(addr, 0, sizeof(*addr));
+    addr->sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof(addr->sun_path)) { fprintf(stderr, "Socket path too long: %s\n", path); return -1; }
+    strcpy(addr->sun_path, path);
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) perror("socket");
+    return fd;
+}
+
+/* Starts listening for a standby on path; returns 1 on success. */
+int repl_listen(const char *path) {
+    struct sockaddr_un addr;
+    int fd = repl_socket(path, &addr);
+    if (fd < 0) return 0;
+    unlink(path);
+    if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 || listen(fd, 1) != 0) {
+        perror(path);
+        close(fd);
+        return 0;
+    }
+    repl_listen_fd = fd;
+    pthread_t t;
+    if (pthread_create(&t, NULL, repl_sender_fn, NULL) != 0 || pthread_create(&t, NULL, repl_accept_fn, NULL) != 0) {
+        perror("pthread_create replication");
+        return 0;
+    }
+    return 1;
+}
+
+size_t repl_usage(int *attached) {
+    pthread_mutex_lock(&repl_mutex);
+    size_t bytes = repl_cap + repl_spare_cap;
+    *attached = repl_fd >= 0;
+    pthread_mutex_unlock(&repl_mutex);
+    return bytes;
+}
+
+/* Standby side of the stream. */
+typedef struct {
+    unsigned long long frames, bytes;
+    double lag_sum_ms, lag_max_ms;
+    double started, synced;       /* wall seconds */
+    int in_sync;
+} standby_stats_t;
+
+static standby_stats_t standby;
+
+static void standby_apply(const char *name, char *payload, size_t len, long long sent_us) {
+    int u = user_find(name, 1);
+    if (u < 0) return;
+    if (task_file) journal_write(u, payload, len);
+    for (char *line = payload, *end = payload + len; line < end; ) {
+        char *nl = memchr(line, '\n', (size_t)(end - line));
+        if (!nl) break;
+        *nl = 0;
+        if ((line[0] == '+' || line[0] == '-') && line[1] == '|') apply_record(u, line + 2, line[0] == '-', 1);
+        line = nl + 1;
+    }
+    double lag = (repl_now_us() - sent_us) / 1000.0;
+    if (lag < 0) lag = 0;
+    standby.frames++;
+    standby.bytes += len;
+    standby.lag_sum_ms += lag;
+    if (lag > standby.lag_max_ms) standby.lag_max_ms = lag;
+    METRIC_SET(repl_lag_us, (long long)(lag * 1000));
+    METRIC_ADD(repl_frames, 1);
+    METRIC_ADD(repl_bytes, len);
+    save_users(0);
+}
+
+/* Follows the primary at path until the connection drops. Returns 0 if it
+   could not connect (after retrying for ten seconds), was refused, or never
+   got the whole snapshot; 1 if it is in sync and may take over. */
+int standby_follow(const char *path) {
+    struct sockaddr_un addr;
+    int fd = repl_socket(path, &addr);
+    if (fd < 0) return 0;
+    int tries = 0;
+    while (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+        if (++tries == 10) { perror(path); close(fd); return 0; }
+        sleep(1);
+    }
+    fprintf(stderr, "Standby: following %s\n", path);
+    standby.started = clock_now_precise();
+    size_t cap = 256 * 1024, have = 0;
+    char *in = malloc(cap);
+    int refused = 0;
+    while (in && !refused) {
+        size_t off = 0;
+        for (;;) {
+            char *nl = memchr(in + off, '\n', have - off);
+            if (!nl) break;
+            char name[32];
+            unsigned long long seq;
+            long long sent;
+            size_t len, head = (size_t)(nl - in) + 1;
+            if (in[off] == 'C') {
+                if (task_file) save_users(1);
+                standby.in_sync = 1;
+                standby.synced = clock_now_precise();
+                fprintf(stderr, "Standby: in sync, %d task(s) after %.3f s.\n",
+                        __atomic_load_n(&store_count, __ATOMIC_RELAXED), standby.synced - standby.started);
+                off = head;
+                continue;
+            }
+            *nl = 0;
+            if (in[off] == 'X') {
+                fprintf(stderr, "Standby: refused by primary: %s\n", in[off + 1] == '|' ? in + off + 2 : "no reason");
+                refused = 1;
+                break;
+            }
+            if (sscanf(in + off, "R|%31[^|]|%llu|%lld|%zu", name, &seq, &sent, &len) != 4) { off = head; continue; }
+            if (head + len > have) { *nl = '\n'; break; }       /* payload not all here yet */
+            standby_apply(name, in + head, len, sent);
+            off = head + len;
+        }
+        if (refused) break;
+        memmove(in, in + off, have - off);
+        have -= off;
+        if (have == cap) {
+            char *p = realloc(in, cap * 2);
+            if (!p) break;
+            in = p;
+            cap *= 2;
+        }
+        ssize_t r = read(fd, in + have, cap - have);
+        if (r < 0 && errno == EINTR) continue;
+        if (r <= 0) break;
+        have += (size_t)r;
+    }
+    free(in);
+    close(fd);
+    if (!standby.in_sync) {
+        if (!refused) fprintf(stderr, "Standby: primary gone before the snapshot completed; not taking over.\n");
+        return 0;
+    }
+    double secs = clock_now_precise() - standby.started;
+    fprintf(stderr, "Standby: primary gone after %.1f s; applied %llu frame(s), %llu bytes (%.0f/s), "
+                    "lag mean %.3f ms max %.3f ms. Taking over.\n",
+            secs, standby.frames, standby.bytes, secs > 0 ? standby.bytes / secs : 0.0,
+            standby.frames ? standby.lag_sum_ms / standby.frames : 0.0, standby.lag_max_ms);
+    return 1;
+}
+
+/* Readies a standby's store to fire: parks waiting tasks and drops early
+   reminders that fell due while following (the primary gave those). */
+void standby_takeover(void) {
+    time_t now = clk->now();
+    store_lock_all();
+    deps_rebuild_locked();
+    for (int i = 0; i < nshards; ++i) {
+        lead_hit_t *hits;
+        shard_take_leads(&shards[i], now, &hits);
+        free(hits);
+    }
+    store_unlock_all();
+    if (task_file) save_users(1);
+}
+
+/* --- User functions --- */
+void add_task() {
+    char title[128], category[32], timestr[64], leadstr[64];
+    int priority;
+    printf("Title: ");
+    if (!fgets(title, sizeof(title), stdin)) return;
+    title[strcspn(title, "\n")] = 0;
+    printf("Category (Work/Study/Personal): ");
+    if (!fgets(category, sizeof(category), stdin)) return;
+    category[strcspn(category, "\n")] = 0;
+    printf("Priority (1–5): ");
+    if (scanf("%d", &priority) != 1) { while(getchar()!='\n'); return; }
+    while(getchar()!='\n');
+    printf("Deadline (YYYY-MM-DD HH:MM): ");
+    if (!fgets(timestr, sizeof(timestr), stdin)) return;
+    timestr[strcspn(timestr, "\n")] = 0;
+
+    time_t dl;
+    if (!parse_deadline(timestr, &dl)) { printf("Invalid time.\n"); return; }
+    printf("Early reminders, e.g. 1d,1h,10m (blank = none): ");
+    if (!fgets(leadstr, sizeof(leadstr), stdin)) return;
+    leadstr[strcspn(leadstr, "\n")] = 0;
+    task_t t;
+    if (!parse_leads(leadstr, t.lead)) { printf("Invalid early reminders (up to %d).\n", TASK_LEADS); return; }
+
+    int id = insert_task_leads(current_user, title, category, priority, dl, t.lead);
+    if (id < 0) {
+        printf(users[current_user].quota ? "Max tasks reached (quota %d).\n" : "Max tasks reached.\n",
+               users[current_user].quota);
+        return;
+    }
+    save_users(0);
+    printf("Task '%s' added.\n", title);
+}
+
+void view_tasks() {
+    int n, k = 0, nc;
+    task_t *all = store_snapshot_sorted(&n), *cold = part_cold_tasks(current_user, &nc);
+    for (int i = 0; i < n; ++i)
+        if (all[i].user == current_user) all[k++] = all[i];
+    n = k;
+    /* Cold partitions lie past the horizon, so they list after the rest. */
+    task_t *p = nc ? realloc(all, sizeof(task_t) * (n + nc)) : NULL;
+    if (p) {
+        all = p;
+        memcpy(all + n, cold, sizeof(task_t) * nc);
+        n += nc;
+    }
+    free(cold);
+    if (n == 0) { printf("No tasks.\n"); free(all); return; }
+    printf("ID | Deadline           | Pri | Category   | Title\n");
+    printf("--------------------------------------------------------------\n");
+    for (int i = 0; i < n; ++i) {
+        char buf[64];
+        char leads[48] = "";
+        format_time(all[i].deadline, buf, sizeof(buf));
+        if (all[i].lead[0]) {
+            memcpy(leads, " (early: ", 9);
+            format_leads(all[i].lead, leads + 9, sizeof(leads) - 10);
+            strcat(leads, ")");
+        }
+        printf("%2d | %s |  %d  | %-10s | %s%s%s\n",
+               all[i].id, buf, all[i].priority, all[i].category, all[i].title, leads,
+               all[i].heap_pos < 0 ? " (waiting on prerequisites)" : "");
+    }
+    free(all);
+}
+
+void delete_task() {
+    int id;
+    printf("Enter id to delete: ");
+    if (scanf("%d", &id) != 1) { while(getchar()!='\n'); return; }
+    while(getchar()!='\n');
+    if (remove_task(current_user, id)) printf("Task %d deleted.\n", id);
+    else printf("Not found.\n");
+    save_users(0);
+}
+
+/* Blank answers keep the current value. */
+void edit_task() {
+    int id;
+    task_t t;
+    char line[128];
+    printf("Enter id to edit: ");
+    if (scanf("%d", &id) != 1) { while(getchar()!='\n'); return; }
+    while(getchar()!='\n');
+    if (!get_task(current_user, id, &t)) { printf("Not found.\n"); return; }
+    unsigned mask = 0;
+    printf("Title [%s]: ", t.title);
+    if (!fgets(line, sizeof(line), stdin)) return;
+    line[strcspn(line, "\n")] = 0;
+    if (*line) { snprintf(t.title, sizeof(t.title), "%.*s", (int)sizeof(t.title) - 1, line); mask |= UPD_TITLE; }
+    printf("Category [%s]: ", t.category);
+    if (!fgets(line, sizeof(line), stdin)) return;
+    line[strcspn(line, "\n")] = 0;
+    if (*line) { snprintf(t.category, sizeof(t.category), "%.*s", (int)sizeof(t.category) - 1, line); mask |= UPD_CATEGORY; }
+    printf("Priority [%d]: ", t.priority);
+    if (!fgets(line, sizeof(line), stdin)) return;
+    line[strcspn(line, "\n")] = 0;
+    if (*line) { t.priority = atoi(line); mask |= UPD_PRIORITY; }
+    format_time(t.deadline, line, sizeof(line));
+    printf("Deadline [%s]: ", line);
+    if (!fgets(line, sizeof(line), stdin)) return;
+    line[strcspn(line, "\n")] = 0;
+    if (*line) {
+        if (!parse_deadline(line, &t.deadline)) { printf("Invalid time.\n"); return; }
+        mask |= UPD_DEADLINE;
+    }
+    format_leads(t.lead, line, sizeof(line));
+    printf("Early reminders [%s]: ", line);
+    if (!fgets(line, sizeof(line), stdin)) return;
+    line[strcspn(line, "\n")] = 0;
+    if (*line) {
+        if (!parse_leads(strcmp(line, "none") ? line : "", t.lead)) { printf("Invalid early reminders.\n"); return; }
+        mask |= UPD_LEAD;
+    }
+    if (!mask) { printf("Unchanged.\n"); return; }
+    if (update_task(current_user, id, &t, mask)) printf("Task %d updated.\n", id);
+    else printf("Not found.\n");
+    save_users(0);
+}
+
+/* Reads one answer into line; returns 0 on EOF. */
+static int prompt(const char *q, char *line, size_t n) {
+    printf("%s", q);
+    if (!fgets(line, (int)n, stdin)) return 0;
+    line[strcspn(line, "\n")] = 0;
+    return 1;
+}
+
+/* Blank answers leave that part of the filter open. */
+void bulk_tasks() {
+    char cat[64], title[128], pri[32], from[64], to[64], act[32];
+    task_filter_t f;
+    filter_init(&f, current_user);
+    if (!prompt("Category (blank = any): ", cat, sizeof(cat)) ||
+        !prompt("Title contains (blank = any): ", title, sizeof(title)) ||
+        !prompt("Priority range, e.g. 2-4 (blank = any): ", pri, sizeof(pri)) ||
+        !prompt("Deadline from (blank = open): ", from, sizeof(from)) ||
+        !prompt("Deadline before (blank = open): ", to, sizeof(to)) ||
+        !prompt("Action (d = delete, +N/-N = move by N minutes): ", act, sizeof(act)))
+        return;
+    if (*cat) f.category = cat;
+    if (*title) f.title = title;
+    if (*pri && sscanf(pri, "%d-%d", &f.pri_min, &f.pri_max) < 1) { printf("Invalid range.\n"); return; }
+    if (*pri && !strchr(pri, '-')) f.pri_max = f.pri_min;
+    if ((*from && !parse_deadline(from, &f.from)) || (*to && !parse_deadline(to, &f.to))) {
+        printf("Invalid time.\n");
+        return;
+    }
+    int n;
+    if (strcmp(act, "d") == 0) {
+        n = bulk_update(&f, 1, 0);
+        printf("%d task(s) deleted.\n", n);
+    } else if ((*act == '+' || *act == '-') && atol(act)) {
+        n = bulk_update(&f, 0, atol(act) * 60);
+        printf("%d task(s) rescheduled.\n", n);
+    } else {
+        printf("Invalid action.\n");
+        return;
+    }
+    save_users(0);
+}
+
+void add_dependency() {
+    int id, pre;
+    printf("Task id: ");
+    if (scanf("%d", &id) != 1) { while(getchar()!='\n'); return; }
+    while(getchar()!='\n');
+    printf("Remind only after task id: ");
+    if (scanf("%d", &pre) != 1) { while(getchar()!='\n'); return; }
+    while(getchar()!='\n');
+    int rc = task_add_after(current_user, id, pre);
+    if (rc == 1) printf("Task %d now waits for task %d.\n", id, pre);
+    else if (rc == -1) printf("Rejected: task %d already depends on %d, directly or not.\n", pre, id);
+    else if (rc == -2) printf("Task %d already waits on %d tasks.\n", id, TASK_DEPS);
+    else printf("Not found.\n");
+    save_users(0);
+}
+
+void ack_reminder() {
+    int id;
+    printf("Acknowledge reminder for task id: ");
+    if (scanf("%d", &id) != 1) { while(getchar()!='\n'); return; }
+    while(getchar()!='\n');
+    if (reminder_ack(current_user, id)) printf("Reminder for task %d acknowledged.\n", id);
+    else printf("No reminder counting down for task %d.\n", id);
+}
+
+void recover_tasks() {
+    char line[64];
+    time_t at;
+    if (!history_keep_us) { printf("History is off (set REMINDER_HISTORY=<days>).\n"); return; }
+    if (!prompt("Recover tasks as of (YYYY-MM-DD HH:MM[:SS]): ", line, sizeof(line))) return;
+    if (!parse_deadline(line, &at)) { printf("Invalid time.\n"); return; }
+    /* A whole-second time includes everything done during that second. */
+    int n = recover_user(current_user, (long long)at * 1000000 + 999999);
+    if (n < 0) printf("No snapshot that old is kept.\n");
+    else printf("Recovered %d task(s) as of %s; the replaced state stays in the history.\n", n, line);
+}
+
+void switch_user() {
+    char name[64];
+    printf("User (current: %s): ", users[current_user].name);
+    if (!fgets(name, sizeof(name), stdin)) return;
+    name[strcspn(name, "\n")] = 0;
+    int u = user_find(name, 0);
+    if (u < 0 && user_name_ok(name)) {
+        char line[16];
+        printf("No user '%s'. ", name);
+        if (!prompt("Create it? (y/n): ", line, sizeof(line)) || (line[0] != 'y' && line[0] != 'Y')) return;
+        if ((u = user_find(name, 1)) >= 0) printf("Created user %s.\n", name);
+    }
+    if (u < 0) { printf("Invalid user name.\n"); return; }
+    current_user = u;
+    printf("Now managing tasks for %s (%d live).\n", users[u].name,
+           __atomic_load_n(&users[u].live, __ATOMIC_RELAXED));
+}
+
+/* Due batches are accounted in metrics.due_bytes until freed. */
+due_copy_t *due_batch_new(task_t *items, int count) {
+    due_copy_t *dc = malloc(sizeof(due_copy_t));
+    dc->items = items;
+    dc->count = count;
+    METRIC_ADD(due_bytes, (long long)(sizeof(due_copy_t) + sizeof(task_t) * count));
+    return dc;
+}
+
+/* Keeps only the first count items; the rest were handed elsewhere. */
+void due_batch_shrink(due_copy_t *dc, int count) {
+    METRIC_ADD(due_bytes, -(long long)(sizeof(task_t) * (dc->count - count)));
+    dc->count = count;
+}
+
+void due_batch_free(due_copy_t *dc) {
+    METRIC_ADD(due_bytes, -(long long)(sizeof(due_copy_t) + sizeof(task_t) * dc->count));
+    free(dc->items);
+    free(dc);
+}
+
+long process_rss_kb(void) {
+    long pages = 0, rss = 0;
+    FILE *f = fopen("/proc/self/statm", "r");
+    if (f) { if (fscanf(f, "%ld %ld", &pages, &rss) != 2) rss = 0; fclose(f); }
+    return rss * (sysconf(_SC_PAGESIZE) / 1024);
+}
+
+/* Where the memory goes. Thread stacks are reserved address space, not
+   necessarily resident; everything else is heap. */
+void memory_report(FILE *out) {
+    size_t str_used = 0, index_bytes = 0, trig_bytes = 0;
+    int count = 0, cap = 0, triggers = 0;
+    for (int si = 0; si < nshards; ++si) {
+        shard_t *s = &shards[si];
+        shard_lock(s);
+        for (int i = 0; i < s->count; ++i)
+            str_used += strlen(s->tasks[i].title) + 1 + strlen(s->tasks[i].category) + 1;
+        count += s->count;
+        cap += s->cap;
+        index_bytes += sizeof(int) * (size_t)s->cap + (sizeof(long long) + sizeof(int)) * (size_t)s->id_cap;
+        trig_bytes += sizeof(trigger_t) * (size_t)s->trig_cap;
+        triggers += s->trig_n;
+        shard_unlock(s);
+    }
+    size_t store_used = sizeof(task_t) * count, store_cap = sizeof(task_t) * cap;
+    size_t str_reserved = (sizeof(((task_t *)0)->title) + sizeof(((task_t *)0)->category)) * count;
+    long long due = METRIC_GET(due_bytes);
+    size_t stack = 0, queue_bytes = 0;
+    unsigned long long steals = 0;
+    for (int i = 0; i < nworkers; ++i) {
+        pthread_mutex_lock(&workers[i].lock);
+        queue_bytes += sizeof(job_t) * workers[i].cap;
+        pthread_mutex_unlock(&workers[i].lock);
+        steals += __atomic_load_n(&workers[i].stolen, __ATOMIC_RELAXED);
+    }
+    pthread_mutex_lock(&timer_mutex);
+    queue_bytes += sizeof(timer_ent_t) * timer_cap;
+    int timers = timer_count;
+    pthread_mutex_unlock(&timer_mutex);
+    pthread_attr_t attr;
+    if (pthread_attr_init(&attr) == 0) {
+        pthread_attr_getstacksize(&attr, &stack);
+        pthread_attr_destroy(&attr);
+    }
+    size_t trace_bytes = sizeof(trace_chunk_t) * __atomic_load_n(&trace_chunks, __ATOMIC_RELAXED);
+
+    fprintf(out, "=== Memory usage ===\n");
+    fprintf(out, "Task store     : %10zu bytes used, %zu reserved (%d/%d tasks x %zu B, %d shards)\n",
+            store_used, store_cap, count, cap, sizeof(task_t), nshards);
+    fprintf(out, "  strings      : %10zu bytes used of %zu inline (%.0f%%)\n",
+            str_used, str_reserved, str_reserved ? 100.0 * str_used / str_reserved : 0.0);
+    fprintf(out, "Indexes        : %10zu bytes (deadline heaps, id maps)\n", index_bytes);
+    fprintf(out, "Lead triggers  : %10zu bytes (%d armed x %zu B)\n", trig_bytes, triggers, sizeof(trigger_t));
+    fprintf(out, "Users          : %10zu bytes (%d of %d slots)\n", sizeof(user_t) * nusers, nusers, MAX_USERS);
+    if (part_mode) {
+        int cold = 0, dirty = 0;
+        store_lock_all();
+        pthread_mutex_lock(&part_mutex);
+        for (int u = 0; u < nusers; ++u) { cold += part_cold[u].n; dirty += part_dirty[u].n; }
+        pthread_mutex_unlock(&part_mutex);
+        store_unlock_all();
+        const char *unit = part_mode == PART_WEEK ? "week" : "month";
+        if (part_horizon) fprintf(out, "Partitions     : %10d dirty, %d cold (by %s, %d ahead loaded)\n",
+                                  dirty, cold, unit, part_horizon);
+        else fprintf(out, "Partitions     : %10d dirty (by %s, all loaded)\n", dirty, unit);
+    }
+    pthread_mutex_lock(&dep_mutex);
+    size_t dep_bytes = sizeof(dep_node_t *) * dep_cap + sizeof(dep_node_t) * dep_nodes;
+    for (int i = 0; i < dep_cap; ++i)
+        for (dep_node_t *d = dep_tab[i]; d; d = d->next) dep_bytes += sizeof(long long) * d->capdeps;
+    int dep_n = dep_nodes;
+    pthread_mutex_unlock(&dep_mutex);
+    fprintf(out, "Dependencies   : %10zu bytes (%d nodes, %d edges)\n", dep_bytes, dep_n,
+            __atomic_load_n(&dep_edges, __ATOMIC_RELAXED));
+    size_t inflight_bytes;
+    int inflight = inflight_usage(&inflight_bytes);
+    fprintf(out, "Due batches    : %10lld bytes\n", due);
+    fprintf(out, "In-flight index: %10zu bytes (%d reminders counting down, %d escalating)\n",
+            inflight_bytes, inflight, escalation_pending());
+    size_t digest_bytes;
+    int digest_n, digest_cats;
+    digest_usage(&digest_bytes, &digest_n, &digest_cats);
+    fprintf(out, "Digest buffer  : %10zu bytes (%d tasks in %d categories)\n", digest_bytes, digest_n, digest_cats);
+    fprintf(out, "Worker stacks  : %10zu bytes reserved (%d workers x %zu B)\n",
+            stack * (size_t)nworkers, nworkers, stack);
+    fprintf(out, "Executor queues: %10zu bytes (%d queued, peak %lld, %d timers, %llu steals)\n",
+            queue_bytes, __atomic_load_n(&exec_pending, __ATOMIC_RELAXED), METRIC_GET(queue_peak),
+            timers, steals);
+    for (int i = 0; i < nworkers; ++i)
+        fprintf(out, "  worker %-6d: %10u queued, %llu run, %llu stolen\n", i, worker_depth(&workers[i]),
+                __atomic_load_n(&workers[i].run, __ATOMIC_RELAXED),
+                __atomic_load_n(&workers[i].stolen, __ATOMIC_RELAXED));
+    int attached;
+    size_t repl_bytes = repl_usage(&attached);
+    fprintf(out, "Replication    : %10zu bytes buffered (%s)\n", repl_bytes,
+            attached ? "standby attached" : "no standby");
+    fprintf(out, "Trace buffers  : %10zu bytes\n", trace_bytes);
+    fprintf(out, "Process RSS    : %10ld KiB\n", process_rss_kb());
+}
+
+/* --- Utility --- */
+/* Earliest deadline across shards (now if something is overdue), 0 if none. */
+time_t next_deadline() {
+    TRACE_BEGIN(t0);
+    time_t now = clk->now();
+    time_t best = 0;
+    for (int i = 0; i < nshards; ++i) {
+        shard_lock(&shards[i]);
+        time_t top = shard_top(&shards[i]);
+        shard_unlock(&shards[i]);
+        if (top && (best == 0 || top < best)) best = top;
+    }
+    if (best && best < now) best = now;
+    trace_span("next_deadline", t0, nshards);
+    return best;
+}
+
+/* --- Reminder Delivery ---
+   A due batch is cut into slices of DELIVER_SLICE tasks, each its own job:
+   format the announcement, write it, then step through the countdown on
+   timers. No thread sleeps through the 60 seconds, and a large burst spreads
+   over the executor. The last slice to finish frees the batch.
+
+   Slices are per user and wait in per-user queues; at most two per worker
+   are announcing at once, taken round-robin over users, so one user's burst
+   queues behind itself instead of in front of everyone else.
+
+   Every task counting down is indexed by its key, so reminder_ack() finds
+   it in O(1) and silences it. Once a slice has nothing left to say its
+   pending timer is cancelled and it ends at once, releasing its share of
+   the batch; if its job is already queued or running, that job ends it. */
+#define DELIVER_SLICE 32
+#define DELIVER_LINE 384
+
+/* In-flight index node; nodes live inside their slice, so indexing a task
+   allocates nothing. pprev is NULL once unlinked. */
+typedef struct inflight {
+    long long key;
+    struct delivery *d;
+    struct inflight *next, **pprev;
+} inflight_t;
+
+typedef struct delivery {
+    due_copy_t *dc;
+    int first, n;          /* slice of dc->items, all one user's */
+    int header;            /* user's task count if this slice opens the announcement */
+    int step;              /* next countdown step */
+    time_t start;          /* when the announcement went out */
+    struct delivery *next; /* fair queue link */
+    int timer;             /* pending countdown timer handle, -1 if none */
+    int live;              /* tasks not yet acknowledged; under inflight_mutex */
+    unsigned acked;        /* bit i: item first + i acknowledged */
+    inflight_t nodes[DELIVER_SLICE];
+} delivery_t;
+
+static inflight_t **inflight_tab;
+static int inflight_cap, inflight_n;
+static pthread_mutex_t inflight_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static delivery_t *fair_head[MAX_USERS], *fair_tail[MAX_USERS];
+static int fair_inflight, fair_next;
+static pthread_mutex_t fair_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/* Countdown (60s total): announce at these offsets from start. */
+static const int countdown_at[] = {30, 40, 55, 59, 60};
+static const int countdown_left[] = {30, 20, 5, 1, 0};
+#define COUNTDOWN_STEPS 5
+
+/* One write per job keeps a slice's lines together on the sink. */
+static void sink_write(const char *buf, size_t len) {
+    TRACE_BEGIN(t0);
+    fwrite(buf, 1, len, stdout);
+    fflush(stdout);
+    trace_span("sink write", t0, (long long)len);
+}
+
+static inflight_t **inflight_bucket(long long key) {
+    return &inflight_tab[((unsigned long long)key * 11400714819323198485ull) >> 40 & (inflight_cap - 1)];
+}
+
+static void inflight_link(inflight_t *n) {
+    if (inflight_n >= inflight_cap) {
+        int old_cap = inflight_cap, cap = inflight_cap ? inflight_cap * 2 : 256;
+        inflight_t **old = inflight_tab, **tab = calloc(cap, sizeof(*tab));
+        if (!tab) { n->pprev = NULL; return; }
+        inflight_tab = tab;
+        inflight_cap = cap;
+        for (int i = 0; i < old_cap; ++i)
+            for (inflight_t *m = old[i], *next; m; m = next) {
+                next = m->next;
+                inflight_t **b = inflight_bucket(m->key);
+                if ((m->next = *b)) (*b)->pprev = &m->next;
+                *b = m;
+                m->pprev = b;
+            }
+        free(old);
+    }
+    inflight_t **b = inflight_bucket(n->key);
+    if ((n->next = *b)) (*b)->pprev = &n->next;
+    *b = n;
+    n->pprev = b;
+    inflight_n++;
+}
+
+static void inflight_unlink(inflight_t *n) {
+    if (!n->pprev) return;
+    if ((*n->pprev = n->next)) n->next->pprev = n->pprev;
+    n->pprev = NULL;
+    inflight_n--;
+}
+
+static inflight_t *inflight_find(long long key) {
+    if (!inflight_cap) return NULL;
+    inflight_t *n = *inflight_bucket(key);
+    while (n && n->key != key) n = n->next;
+    return n;
+}
+
+/* Unindexes what is left of d, settles the accounting and drops d's share
+   of the batch. Returns 1 if that freed the batch. */
+static int delivery_end(delivery_t *d) {
+    pthread_mutex_lock(&inflight_mutex);
+    for (int i = 0; i < d->n; ++i) inflight_unlink(&d->nodes[i]);
+    int live = d->live;
+    d->live = 0;
+    pthread_mutex_unlock(&inflight_mutex);
+    METRIC_ADD(due_inflight, -live);
+    int last = __atomic_sub_fetch(&d->dc->refs, 1, __ATOMIC_ACQ_REL) == 0;
+    if (last) due_batch_free(d->dc);
+    free(d);
+    return last;
+}
+
+static void deliver_countdown(void *arg);
+
+/* Arms d's next countdown step; returns 0 instead if every task in it was
+   acknowledged meanwhile, and the caller ends d. */
+static int delivery_rearm(delivery_t *d, time_t at) {
+    if (!nworkers) { timer_at(at, deliver_countdown, d); return 1; }   /* runs inline */
+    pthread_mutex_lock(&inflight_mutex);
+    int live = d->live;
+    if (live) timer_arm(at, deliver_countdown, d, &d->timer);
+    pthread_mutex_unlock(&inflight_mutex);
+    return live;
+}
+
+/* Which of d's tasks are still being reminded; 0 if none. */
+static unsigned delivery_live(delivery_t *d) {
+    pthread_mutex_lock(&inflight_mutex);
+    unsigned mask = d->live ? ~d->acked : 0;
+    pthread_mutex_unlock(&inflight_mutex);
+    return mask;
+}
+
+/* Returns the number of indexed reminders; *bytes gets the index size. */
+int inflight_usage(size_t *bytes) {
+    pthread_mutex_lock(&inflight_mutex);
+    int n = inflight_n;
+    *bytes = sizeof(inflight_t *) * inflight_cap;
+    pthread_mutex_unlock(&inflight_mutex);
+    return n;
+}
+
+/* Stops the countdown of user's task id if it is in flight, and any
+   escalation still pending for it: nothing further is printed for it.
+   Returns 1 if either was found. */
+int reminder_ack(int user, int id) {
+    delivery_t *done = NULL;
+    pthread_mutex_lock(&inflight_mutex);
+    inflight_t *n = inflight_find(task_key(user, id));
+    if (n) {
+        delivery_t *d = n->d;
+        inflight_unlink(n);
+        d->acked |= 1u << (n - d->nodes);
+        if (--d->live == 0 && timer_cancel(&d->timer)) done = d;
+    }
+    pthread_mutex_unlock(&inflight_mutex);
+    int escalated = escalation_ack(user, id);
+    if (!n && !escalated) return 0;
+    if (n) METRIC_ADD(due_inflight, -1);
+    METRIC_ADD(acks, 1);
+    trace_instant("ack", id);
+    if (done && delivery_end(done)) sink_write("Reminder finished.\n", 19);
+    return 1;
+}
+
+static void deliver_countdown(void *arg) {
+    delivery_t *d = arg;
+    char buf[DELIVER_SLICE * DELIVER_LINE];
+    size_t len = 0;
+    int left = countdown_left[d->step];
+    unsigned live = delivery_live(d);
+    if (!live) {
+        if (delivery_end(d)) sink_write("Reminder finished.\n", 19);
+        return;
+    }
+    for (int i = d->first; i < d->first + d->n; ++i) {
+        if (!(live >> (i - d->first) & 1)) continue;
+        if (left > 0)
+            len += snprintf(buf + len, sizeof(buf) - len, "Reminder: \"%s\" is closing in %d seconds...\n",
+                            d->dc->items[i].title, left);
+        else
+            len += snprintf(buf + len, sizeof(buf) - len, "Final reminder: \"%s\" deadline reached! Clearing now.\n",
+                            d->dc->items[i].title);
+    }
+    trace_instant("countdown", left);
+    if (++d->step < COUNTDOWN_STEPS) {
+        sink_write(buf, len);
+        if (!delivery_rearm(d, d->start + countdown_at[d->step]) && delivery_end(d))
+            sink_write("Reminder finished.\n", 19);
+        return;
+    }
+    if (delivery_end(d)) len += snprintf(buf + len, sizeof(buf) - len, "Reminder finished.\n");
+    sink_write(buf, len);
+}
+
+static void fair_pump(void);
+static void digest_take(due_copy_t *dc);
+
+static void deliver_announce(void *arg) {
+    delivery_t *d = arg;
+    char buf[DELIVER_SLICE * DELIVER_LINE + 128];
+    size_t len = 0;
+    int user = d->dc->items[d->first].user;
+    unsigned live = delivery_live(d);
+    if (!live) {
+        int last = delivery_end(d);
+        pthread_mutex_lock(&fair_mutex);
+        fair_inflight--;
+        pthread_mutex_unlock(&fair_mutex);
+        if (last) sink_write("Reminder finished.\n", 19);
+        fair_pump();
+        return;
+    }
+    if (d->header && user)
+        len += snprintf(buf, sizeof(buf), "\n====== REMINDER for %s: %d task(s) due ======\n",
+                        users[user].name, d->header);
+    else if (d->header)
+        len += snprintf(buf, sizeof(buf), "\n====== REMINDER: %d task(s) due ======\n", d->header);
+    for (int i = d->first; i < d->first + d->n; ++i) {
+        const task_t *t = &d->dc->items[i];
+        char when[64];
+        if (!(live >> (i - d->first) & 1)) continue;
+        format_time(t->deadline, when, sizeof(when));
+        len += snprintf(buf + len, sizeof(buf) - len, "  - #%d [%s] %s (priority %d) due at %s\n",
+                        t->id, t->category, t->title, t->priority, when);
+    }
+    sink_write(buf, len);
+    d->start = clk->now();
+    if (!delivery_rearm(d, d->start + countdown_at[0]) && delivery_end(d))
+        sink_write("Reminder finished.\n", 19);
+    pthread_mutex_lock(&fair_mutex);
+    fair_inflight--;
+    pthread_mutex_unlock(&fair_mutex);
+    fair_pump();
+}
+
+/* Hands queued slices to the executor while the window has room. */
+static void fair_pump(void) {
+    for (;;) {
+        delivery_t *d = NULL;
+        pthread_mutex_lock(&fair_mutex);
+        int window = nworkers ? 2 * nworkers : 1;
+        for (int k = 0; k < nusers && !d && fair_inflight < window; ++k) {
+            int u = (fair_next + k) % nusers;
+            if (!(d = fair_head[u])) continue;
+            if (!(fair_head[u] = d->next)) fair_tail[u] = NULL;
+            fair_next = u + 1;
+            fair_inflight++;
+        }
+        pthread_mutex_unlock(&fair_mutex);
+        if (!d) return;
+        executor_submit(deliver_announce, d);
+    }
+}
+
+static int cmp_user_deadline(const void *a, const void *b) {
+    const task_t *x = a, *y = b;
+    if (x->user != y->user) return x->user < y->user ? -1 : 1;
+    return cmp_deadline(a, b);
+}
+
+void submit_reminders(due_copy_t *dc) {
+    digest_take(dc);
+    if (dc->count <= 0) { due_batch_free(dc); return; }
+    escalation_watch(dc);
+    qsort(dc->items, dc->count, sizeof(task_t), cmp_user_deadline);
+    int slices = 0;
+    for (int i = 0; i < dc->count; ) {
+        int end = i;
+        while (end < dc->count && dc->items[end].user == dc->items[i].user) end++;
+        slices += (end - i + DELIVER_SLICE - 1) / DELIVER_SLICE;
+        i = end;
+    }
+    dc->refs = slices;
+    METRIC_ADD(due_inflight, dc->count);
+    pthread_mutex_lock(&fair_mutex);
+    for (int i = 0; i < dc->count; ) {
+        int user = dc->items[i].user, end = i;
+        while (end < dc->count && dc->items[end].user == user) end++;
+        for (int first = i; first < end; first += DELIVER_SLICE) {
+            delivery_t *d = calloc(1, sizeof(*d));
+            d->dc = dc;
+            d->first = first;
+            d->n = end - first < DELIVER_SLICE ? end - first : DELIVER_SLICE;
+            d->header = first == i ? end - i : 0;
+            d->timer = -1;
+            d->live = d->n;
+            pthread_mutex_lock(&inflight_mutex);
+            for (int k = 0; k < d->n; ++k) {
+                d->nodes[k].key = task_key(user, dc->items[first + k].id);
+                d->nodes[k].d = d;
+                inflight_link(&d->nodes[k]);
+            }
+            pthread_mutex_unlock(&inflight_mutex);
+            if (fair_tail[user]) fair_tail[user]->next = d;
+            else fair_head[user] = d;
+            fair_tail[user] = d;
+        }
+        i = end;
+    }
+    pthread_mutex_unlock(&fair_mutex);
+    fair_pump();
+}
+
+/* Early reminders are one line each, no countdown; a batch is one job. */
+typedef struct {
+    lead_hit_t *hits;
+    int n;
+} lead_batch_t;
+
+static void deliver_leads(void *arg) {
+    lead_batch_t *b = arg;
+    size_t cap = (size_t)b->n * DELIVER_LINE, len = 0;
+    char *buf = malloc(cap);
+    for (int i = 0; buf && i < b->n; ++i) {
+        const task_t *t = &b->hits[i].task;
+        char when[64], in[48];
+        int lead[TASK_LEADS] = { b->hits[i].lead };
+        format_time(t->deadline, when, sizeof(when));
+        format_leads(lead, in, sizeof(in));
+        if (t->user)
+            len += snprintf(buf + len, cap - len, "Heads-up for %s: [%s] %s (priority %d) is due in %s, at %s\n",
+                            users[t->user].name, t->category, t->title, t->priority, in, when);
+        else
+            len += snprintf(buf + len, cap - len, "Heads-up: [%s] %s (priority %d) is due in %s, at %s\n",
+                            t->category, t->title, t->priority, in, when);
+    }
+    if (buf) sink_write(buf, len);
+    free(buf);
+    free(b->hits);
+    free(b);
+}
 
-pthread_mutex_t tasks_mutex = PTHREAD_MUTEX_INITIALIZER;
-volatile sig_atomic_t alarm_fired = 0;
+void submit_leads(lead_hit_t *hits, int n) {
+    lead_batch_t *b = malloc(sizeof(*b));
+    b->hits = hits;
+    b->n = n;
+    METRIC_ADD(leads_fired, n);
+    trace_instant("lead triggers", n);
+    executor_submit(deliver_leads, b);
+}
+
+/* --- Digest ---
+   With REMINDER_DIGEST=N, fired tasks of priority below N get no
+   announcement or countdown: they collect in one buffer per (user,
+   category) and go out as a single summary every REMINDER_DIGEST_INTERVAL
+   seconds (default 300, aligned to the interval). Higher priorities are
+   still delivered at once. A flush is one timer and one job however many
+   tasks it covers. It runs on the executor's timer thread, so without
+   workers the digest is off; Save & Exit flushes whatever is still held. */
+typedef struct {
+    int user;
+    char category[32];
+    task_t *items;
+    int n, cap;
+} digest_bucket_t;
+
+int digest_below = 0;            /* 0 = off */
+int digest_interval = 300;
+static digest_bucket_t *digest_buckets;
+static int digest_nbuckets, digest_capbuckets, digest_armed;
+static pthread_mutex_t digest_mutex = PTHREAD_MUTEX_INITIALIZER;
 
-/* --- Signal handler --- */
-void sigalrm_handler(int sig) {
-    (void)sig;
-    alarm_fired = 1;
-    write(STDOUT_FILENO, "\n[!] SIGALRM triggered: task reminder due.\n", 43);
+void digest_config(void) {
+    const char *p = getenv("REMINDER_DIGEST");
+    if (p && atoi(p) > 0) digest_below = atoi(p);
+    if ((p = getenv("REMINDER_DIGEST_INTERVAL")) && atoi(p) > 0) digest_interval = atoi(p);
 }
 
-/* --- Helpers --- */
-void format_time(time_t t, char *buf, size_t n) {
-    struct tm tm;
-    localtime_r(&t, &tm);
-    strftime(buf, n, "%Y-%m-%d %H:%M", &tm);
+static int cmp_bucket(const void *a, const void *b) {
+    const digest_bucket_t *x = a, *y = b;
+    if (x->user != y->user) return x->user < y->user ? -1 : 1;
+    return strcmp(x->category, y->category);
 }
 
-/* Load & Save Tasks */
-void load_tasks() {
-    pthread_mutex_lock(&tasks_mutex);
-    FILE *f = fopen(TASK_FILE, "r");
-    if (!f) { pthread_mutex_unlock(&tasks_mutex); return; }
-    char line[LINE_BUF];
-    task_count = 0; next_id = 1;
-    while (fgets(line, sizeof(line), f) && task_count < MAX_TASKS) {
-        char *nl = strchr(line, '\n'); if (nl) *nl = 0;
-        int id; char title[128], cat[32]; int pr; long long dl;
-        if (sscanf(line, "%d|%127[^|]|%31[^|]|%d|%lld", &id, title, cat, &pr, &dl) == 5) {
-            tasks[task_count].id = id;
-            strncpy(tasks[task_count].title, title, sizeof(tasks[task_count].title)-1);
-            strncpy(tasks[task_count].category, cat, sizeof(tasks[task_count].category)-1);
-            tasks[task_count].priority = pr;
-            tasks[task_count].deadline = (time_t)dl;
-            task_count++;
-            if (id >= next_id) next_id = id + 1;
+static void digest_flush(void *arg) {
+    (void)arg;
+    pthread_mutex_lock(&digest_mutex);
+    digest_bucket_t *b = digest_buckets;
+    int nb = digest_nbuckets, total = 0;
+    digest_buckets = NULL;
+    digest_nbuckets = digest_capbuckets = digest_armed = 0;
+    pthread_mutex_unlock(&digest_mutex);
+    if (nb <= 0) return;
+    qsort(b, nb, sizeof(*b), cmp_bucket);
+    for (int i = 0; i < nb; ++i) total += b[i].n;
+    size_t cap = 128 + (size_t)nb * DELIVER_LINE, len = 0;
+    char *buf = malloc(cap);
+    if (buf) len = snprintf(buf, cap, "\n====== DIGEST: %d low-priority reminder(s) ======\n", total);
+    for (int i = 0; buf && i < nb; ++i) {
+        len += snprintf(buf + len, cap - len, "  %s%s%s (%d):", b[i].user ? users[b[i].user].name : "",
+                        b[i].user ? " / " : "", b[i].category, b[i].n);
+        size_t start = len;
+        for (int k = 0; k < b[i].n; ++k) {
+            if (len - start + strlen(b[i].items[k].title) + 2 > DELIVER_LINE - 128) {
+                len += snprintf(buf + len, cap - len, " and %d more", b[i].n - k);
+                break;
+            }
+            len += snprintf(buf + len, cap - len, "%s %s", k ? "," : "", b[i].items[k].title);
         }
+        buf[len++] = '\n';
     }
-    fclose(f);
-    pthread_mutex_unlock(&tasks_mutex);
+    if (buf) sink_write(buf, len);
+    free(buf);
+    for (int i = 0; i < nb; ++i) free(b[i].items);
+    free(b);
+    METRIC_ADD(digests, 1);
+    trace_instant("digest", total);
 }
 
-void save_tasks() {
-    pthread_mutex_lock(&tasks_mutex);
-    FILE *f = fopen(TASK_FILE, "w");
-    if (!f) { perror("save_tasks"); pthread_mutex_unlock(&tasks_mutex); return; }
-    for (int i = 0; i < task_count; ++i) {
-        fprintf(f, "%d|%s|%s|%d|%lld\n",
-                tasks[i].id, tasks[i].title, tasks[i].category,
-                tasks[i].priority, (long long)tasks[i].deadline);
+void digest_usage(size_t *bytes, int *tasks, int *cats) {
+    pthread_mutex_lock(&digest_mutex);
+    *bytes = sizeof(digest_bucket_t) * digest_capbuckets;
+    *tasks = 0;
+    for (int i = 0; i < digest_nbuckets; ++i) {
+        *bytes += sizeof(task_t) * digest_buckets[i].cap;
+        *tasks += digest_buckets[i].n;
     }
-    fclose(f);
-    pthread_mutex_unlock(&tasks_mutex);
+    *cats = digest_nbuckets;
+    pthread_mutex_unlock(&digest_mutex);
 }
 
-/* --- User functions --- */
-void add_task() {
-    char title[128], category[32], timestr[64];
-    int priority;
-    printf("Title: ");
-    if (!fgets(title, sizeof(title), stdin)) return;
-    title[strcspn(title, "\n")] = 0;
-    printf("Category (Work/Study/Personal): ");
-    if (!fgets(category, sizeof(category), stdin)) return;
-    category[strcspn(category, "\n")] = 0;
-    printf("Priority (1–5): ");
-    if (scanf("%d", &priority) != 1) { while(getchar()!='\n'); return; }
-    while(getchar()!='\n');
-    printf("Deadline (YYYY-MM-DD HH:MM): ");
-    if (!fgets(timestr, sizeof(timestr), stdin)) return;
-    timestr[strcspn(timestr, "\n")] = 0;
-
-    struct tm tm = {0};
-    if (!strptime(timestr, "%Y-%m-%d %H:%M", &tm)) { printf("Invalid time.\n"); return; }
-    time_t dl = mktime(&tm);
-
-    pthread_mutex_lock(&tasks_mutex);
-    if (task_count >= MAX_TASKS) { pthread_mutex_unlock(&tasks_mutex); printf("Max tasks reached.\n"); return; }
-    task_t *t = &tasks[task_count++];
-    t->id = next_id++;
-    strncpy(t->title, title, sizeof(t->title)-1);
-    strncpy(t->category, category, sizeof(t->category)-1);
-    t->priority = priority;
-    t->deadline = dl;
-    pthread_mutex_unlock(&tasks_mutex);
-    save_tasks();
-    printf("Task '%s' added.\n", title);
+/* Moves dc's tasks below digest_below into the digest, keeping the rest in
+   order, and arms the next flush if the digest was empty. */
+static void digest_take(due_copy_t *dc) {
+    if (!digest_below || !nworkers) return;
+    int keep = 0, taken = 0, arm = 0;
+    pthread_mutex_lock(&digest_mutex);
+    for (int i = 0; i < dc->count; ++i) {
+        const task_t *t = &dc->items[i];
+        if (t->priority >= digest_below) { dc->items[keep++] = *t; continue; }
+        int k = 0;
+        while (k < digest_nbuckets && (digest_buckets[k].user != t->user ||
+                                       strcmp(digest_buckets[k].category, t->category) != 0)) k++;
+        if (k == digest_nbuckets) {
+            if (k == digest_capbuckets) {
+                int cap = digest_capbuckets ? digest_capbuckets * 2 : 8;
+                digest_bucket_t *p = realloc(digest_buckets, sizeof(*p) * cap);
+                if (!p) { dc->items[keep++] = *t; continue; }
+                digest_buckets = p;
+                digest_capbuckets = cap;
+            }
+            memset(&digest_buckets[k], 0, sizeof(digest_bucket_t));
+            digest_buckets[k].user = t->user;
+            memcpy(digest_buckets[k].category, t->category, sizeof(t->category));
+            digest_nbuckets++;
+        }
+        digest_bucket_t *bk = &digest_buckets[k];
+        if (bk->n == bk->cap) {
+            int cap = bk->cap ? bk->cap * 2 : 16;
+            task_t *p = realloc(bk->items, sizeof(task_t) * cap);
+            if (!p) { dc->items[keep++] = *t; continue; }
+            bk->items = p;
+            bk->cap = cap;
+        }
+        bk->items[bk->n++] = *t;
+        taken++;
+    }
+    if (taken && !digest_armed) arm = digest_armed = 1;
+    pthread_mutex_unlock(&digest_mutex);
+    if (!taken) return;
+    due_batch_shrink(dc, keep);
+    METRIC_ADD(digest_tasks, taken);
+    if (arm) timer_at((clk->now() / digest_interval + 1) * digest_interval, digest_flush, NULL);
 }
 
-void view_tasks() {
-    pthread_mutex_lock(&tasks_mutex);
-    if (task_count == 0) { printf("No tasks.\n"); pthread_mutex_unlock(&tasks_mutex); return; }
-    printf("ID | Deadline           | Pri | Category   | Title\n");
-    printf("--------------------------------------------------------------\n");
-    for (int i = 0; i < task_count; ++i) {
-        char buf[64];
-        format_time(tasks[i].deadline, buf, sizeof(buf));
-        printf("%2d | %s |  %d  | %-10s | %s\n",
-               tasks[i].id, buf, tasks[i].priority, tasks[i].category, tasks[i].title);
+/* --- Escalation ---
+   With REMINDER_ESCALATE=N, a fired task of priority N or more that is not
+   acknowledged within REMINDER_ESCALATE_AFTER seconds (default 300) is
+   announced again on the next sink of REMINDER_ESCALATE_SINKS (default
+   "stderr"; entries are stderr, stdout or file:PATH), then the one after,
+   each a further interval later, until the chain runs out. Each pending
+   escalation is one timer on the executor, cancelled by an acknowledgement.
+   Pending escalations are rewritten to <file>.escalations on every change
+   as level|next_at|user|record and rearmed at startup; one already due
+   fires at once. Needs executor workers, like the digest. */
+#define ESCALATE_SINKS 4
+
+typedef struct {
+    task_t task;
+    int level;                   /* sinks already used */
+    time_t next_at;
+    int timer;                   /* handle; -1 while the job is queued or running */
+    int acked;                   /* acknowledged while its job was in flight */
+} escalation_t;
+
+int escalate_from = 0;           /* lowest escalating priority, 0 = off */
+int escalate_after = 300;
+static int esc_fd[ESCALATE_SINKS], esc_nsinks;
+static char esc_names[ESCALATE_SINKS][64];
+static escalation_t **esc_list;
+static int esc_n, esc_cap;
+static pthread_mutex_t esc_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+void escalation_config(void) {
+    const char *p = getenv("REMINDER_ESCALATE");
+    if (!p || atoi(p) <= 0) return;
+    escalate_from = atoi(p);
+    if ((p = getenv("REMINDER_ESCALATE_AFTER")) && atoi(p) > 0) escalate_after = atoi(p);
+    if (!(p = getenv("REMINDER_ESCALATE_SINKS")) || !*p) p = "stderr";
+    while (*p && esc_nsinks < ESCALATE_SINKS) {
+        size_t len = strcspn(p, ",");
+        char *name = esc_names[esc_nsinks];
+        snprintf(name, sizeof(esc_names[0]), "%.*s", (int)len, p);
+        int fd = strcmp(name, "stderr") == 0 ? STDERR_FILENO : strcmp(name, "stdout") == 0 ? STDOUT_FILENO
+               : strncmp(name, "file:", 5) == 0 ? open(name + 5, O_WRONLY | O_CREAT | O_APPEND, 0644) : -1;
+        if (fd < 0) fprintf(stderr, "Ignoring escalation sink '%s'.\n", name);
+        else esc_fd[esc_nsinks++] = fd;
+        p += len + (p[len] == ',');
     }
-    pthread_mutex_unlock(&tasks_mutex);
+    if (!esc_nsinks) escalate_from = 0;
 }
 
-void delete_task() {
-    int id;
-    printf("Enter id to delete: ");
-    if (scanf("%d", &id) != 1) { while(getchar()!='\n'); return; }
-    while(getchar()!='\n');
-    pthread_mutex_lock(&tasks_mutex);
-    int idx = -1;
-    for (int i = 0; i < task_count; ++i) if (tasks[i].id == id) { idx = i; break; }
-    if (idx != -1) {
-        for (int i = idx; i < task_count - 1; ++i) tasks[i] = tasks[i+1];
-        task_count--;
-        printf("Task %d deleted.\n", id);
-    } else printf("Not found.\n");
-    pthread_mutex_unlock(&tasks_mutex);
-    save_tasks();
+/* Rewrites the escalations file from esc_list; caller holds esc_mutex. */
+static void escalation_save_locked(void) {
+    if (!task_file) return;
+    char path[PATH_MAX], tmp[PATH_MAX + 4];
+    snprintf(path, sizeof(path), "%s.escalations", task_file);
+    if (!esc_n) { unlink(path); return; }
+    snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+    FILE *f = fopen(tmp, "w");
+    if (!f) { perror(tmp); return; }
+    for (int i = 0; i < esc_n; ++i) {
+        char rec[RECORD_MAX];
+        char *end = serialize_task(rec, &esc_list[i]->task);
+        fprintf(f, "%d|%lld|%s|%.*s", esc_list[i]->level, (long long)esc_list[i]->next_at,
+                users[esc_list[i]->task.user].name, (int)(end - rec), rec);
+    }
+    if (fclose(f) != 0 || rename(tmp, path) != 0) { perror(path); unlink(tmp); }
 }
 
-/* --- Utility --- */
-time_t next_deadline() {
-    pthread_mutex_lock(&tasks_mutex);
-    time_t now = time(NULL);
-    time_t best = 0;
-    for (int i = 0; i < task_count; ++i) {
-        if (tasks[i].deadline <= now) { best = now; break; }
-        if (best == 0 || tasks[i].deadline < best) best = tasks[i].deadline;
+static void escalation_fire(void *arg);
+
+/* Queues e and arms its timer; caller holds esc_mutex. */
+static void escalation_add_locked(escalation_t *e) {
+    if (esc_n == esc_cap) {
+        int cap = esc_cap ? esc_cap * 2 : 16;
+        escalation_t **p = realloc(esc_list, sizeof(*p) * cap);
+        if (!p) { free(e); return; }
+        esc_list = p;
+        esc_cap = cap;
     }
-    pthread_mutex_unlock(&tasks_mutex);
-    return best;
+    esc_list[esc_n++] = e;
+    timer_arm(e->next_at, escalation_fire, e, &e->timer);
+}
+
+static void escalation_drop_locked(escalation_t *e) {
+    for (int i = 0; i < esc_n; ++i)
+        if (esc_list[i] == e) { esc_list[i] = esc_list[--esc_n]; return; }
 }
 
-/* --- Reminder Thread --- */
-void *reminder_thread_fn(void *arg) {
-    due_copy_t *dc = (due_copy_t *)arg;
-    if (!dc || dc->count <= 0) return NULL;
+static void escalation_fire(void *arg) {
+    escalation_t *e = arg;
+    pthread_mutex_lock(&esc_mutex);
+    if (e->acked) { pthread_mutex_unlock(&esc_mutex); free(e); return; }
+    const task_t *t = &e->task;
+    char line[DELIVER_LINE], when[64];
+    format_time(t->deadline, when, sizeof(when));
+    int len = snprintf(line, sizeof(line), "ESCALATION %d/%d: %s%s#%d [%s] %s (priority %d) due at %s is unacknowledged\n",
+                       e->level + 1, esc_nsinks, t->user ? users[t->user].name : "", t->user ? ": " : "",
+                       t->id, t->category, t->title, t->priority, when);
+    if (len >= (int)sizeof(line)) len = sizeof(line) - 1;
+    if (write(esc_fd[e->level], line, (size_t)len) < 0) perror(esc_names[e->level]);
+    METRIC_ADD(escalations, 1);
+    trace_instant("escalation", e->level);
+    if (++e->level < esc_nsinks) {
+        e->next_at = clk->now() + escalate_after;
+        timer_arm(e->next_at, escalation_fire, e, &e->timer);
+    } else {
+        escalation_drop_locked(e);
+        free(e);
+    }
+    escalation_save_locked();
+    pthread_mutex_unlock(&esc_mutex);
+}
 
-    printf("\n====== REMINDER: %d task(s) due ======\n", dc->count);
+/* Starts an escalation chain for each task of dc at or above escalate_from. */
+void escalation_watch(const due_copy_t *dc) {
+    if (!escalate_from || !nworkers) return;
+    time_t at = clk->now() + escalate_after;
+    int added = 0;
+    pthread_mutex_lock(&esc_mutex);
     for (int i = 0; i < dc->count; ++i) {
-        char buf[64];
-        format_time(dc->items[i].deadline, buf, sizeof(buf));
-        printf("  - [%s] %s (priority %d) due at %s\n",
-               dc->items[i].category, dc->items[i].title,
-               dc->items[i].priority, buf);
+        if (dc->items[i].priority < escalate_from) continue;
+        escalation_t *e = calloc(1, sizeof(*e));
+        if (!e) continue;
+        e->task = dc->items[i];
+        e->next_at = at;
+        escalation_add_locked(e);
+        added++;
     }
+    if (added) escalation_save_locked();
+    pthread_mutex_unlock(&esc_mutex);
+}
 
-    /* Countdown intervals (60s total) */
-    int intervals[] = {30, 10, 15, 4, 1};
-    int announce_secs[] = {30, 20, 5, 1, 0};
+/* Cancels the pending escalation of user's task id; returns 1 if found. */
+int escalation_ack(int user, int id) {
+    if (!escalate_from) return 0;
+    pthread_mutex_lock(&esc_mutex);
+    escalation_t *e = NULL;
+    for (int i = 0; i < esc_n && !e; ++i)
+        if (esc_list[i]->task.user == user && esc_list[i]->task.id == id) e = esc_list[i];
+    if (e) {
+        escalation_drop_locked(e);
+        if (timer_cancel(&e->timer)) free(e);
+        else e->acked = 1;
+        escalation_save_locked();
+    }
+    pthread_mutex_unlock(&esc_mutex);
+    return e != NULL;
+}
 
-    for (int k = 0; k < 5; ++k) {
-        sleep(intervals[k]);
-        for (int i = 0; i < dc->count; ++i) {
-            if (announce_secs[k] > 0)
-                printf("Reminder: \"%s\" is closing in %d seconds...\n",
-                       dc->items[i].title, announce_secs[k]);
-            else
-                printf("Final reminder: \"%s\" deadline reached! Clearing now.\n",
-                       dc->items[i].title);
+/* Rearms the escalations pending at the last exit; call once the executor
+   is running. Entries for users or sinks that no longer exist are dropped. */
+void escalation_load(void) {
+    if (!task_file || !escalate_from || !nworkers) return;
+    char path[PATH_MAX], line[LINE_BUF + 64];
+    snprintf(path, sizeof(path), "%s.escalations", task_file);
+    FILE *f = fopen(path, "r");
+    if (!f) return;
+    pthread_mutex_lock(&esc_mutex);
+    while (fgets(line, sizeof(line), f)) {
+        line[strcspn(line, "\n")] = 0;
+        long long level, next_at;
+        char name[32], *p = take_number(line, &level);
+        if (!p || *p != '|' || !(p = take_number(p + 1, &next_at)) || *p != '|') continue;
+        p = take_text(p + 1, name, sizeof(name));
+        escalation_t *e = calloc(1, sizeof(*e));
+        int u = *p == '|' ? user_find(name, 0) : -1;
+        if (!e || u < 0 || level < 0 || level >= esc_nsinks || !parse_task_line(p + 1, &e->task)) {
+            free(e);
+            continue;
         }
+        e->task.user = u;
+        e->level = (int)level;
+        e->next_at = (time_t)next_at;
+        escalation_add_locked(e);
     }
+    fclose(f);
+    pthread_mutex_unlock(&esc_mutex);
+}
 
-    free(dc->items);
-    free(dc);
-    printf("Reminder finished.\n");
+int escalation_pending(void) {
+    pthread_mutex_lock(&esc_mutex);
+    int n = esc_n;
+    pthread_mutex_unlock(&esc_mutex);
+    return n;
+}
+
+/* --- Scheduler Threads ---
+   One per shard. Each sleeps on its shard's condition variable until the
+   earliest deadline or early reminder, and inserts of an earlier one wake
+   it. */
+static int shard_fire(shard_t *s, time_t now) {
+    task_t *copies;
+    lead_hit_t *hits;
+    shard_lock(s);
+    int nhits = shard_take_leads(s, now, &hits);
+    int due_count = shard_take_due(s, now, &copies);
+    journal_drop(copies, due_count);
+    shard_unlock(s);
+    if (nhits) submit_leads(hits, nhits);
+    if (due_count == 0) return 0;
+    deps_done(copies, due_count);
+
+    double fired_at = clock_now_precise();
+    for (int i = 0; i < due_count; ++i) metrics_observe_late(fired_at - copies[i].deadline);
+    METRIC_ADD(tasks_fired, due_count);
+    METRIC_ADD(batches, 1);
+    METRIC_SET(last_batch, due_count);
+
+    save_users_background();
+
+    deliver_due(due_batch_new(copies, due_count));
+    return due_count;
+}
+
+void *shard_scheduler_fn(void *arg) {
+    shard_t *s = arg;
+    trace_thread_name("scheduler");
+    shard_lock(s);
+    while (scheduler_running) {
+        time_t nd = shard_next(s);
+        if (nd == 0 || nd > clk->now()) { shard_wait(s, nd); continue; }
+        shard_unlock(s);
+        shard_fire(s, clk->now());
+        shard_lock(s);
+    }
+    shard_unlock(s);
     return NULL;
 }
 
-/* --- Scheduler Thread --- */
-void *scheduler_thread_fn(void *arg) {
-    (void)arg;
-    while (1) {
-        time_t nd = next_deadline();
-        time_t now = time(NULL);
+/* Starts one scheduler per shard, pinned round-robin to online CPUs when
+   there is more than one shard. */
+void scheduler_start(void) {
+    long ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+    for (int i = 0; i < nshards; ++i) {
+        if (pthread_create(&shards[i].thread, NULL, shard_scheduler_fn, &shards[i]) != 0) {
+            perror("pthread_create scheduler");
+            continue;
+        }
+        if (nshards > 1 && ncpu > 1) {
+            cpu_set_t set;
+            CPU_ZERO(&set);
+            CPU_SET(i % ncpu, &set);
+            pthread_setaffinity_np(shards[i].thread, sizeof(set), &set);
+        }
+    }
+}
+
+/* Single-threaded driver for the virtual clock: repeatedly jumps to the
+   earliest deadline or trigger over all shards and fires that shard. Returns when
+   scheduler_running drops or nothing is left. */
+void scheduler_run_virtual(void) {
+    trace_thread_name("scheduler");
+    while (scheduler_running) {
+        shard_t *next = NULL;
+        time_t best = 0;
+        for (int i = 0; i < nshards; ++i) {
+            shard_lock(&shards[i]);
+            time_t top = shard_next(&shards[i]);
+            shard_unlock(&shards[i]);
+            if (top && (best == 0 || top < best)) { best = top; next = &shards[i]; }
+        }
+        if (!next) break;
+        clk->wait_until(NULL, NULL, best);
+        shard_fire(next, clk->now());
+    }
+}
+
+/* --- Catch-up ---
+   Tasks that fell due while the program was down are handled once at
+   startup instead of reaching the scheduler as one giant batch:
+     summary  list them, in chunks of catchup_batch, and drop them
+     top      keep only the highest priority ones and replay those
+     replay   keep all, refiring catchup_batch at a time every catchup_spacing s
+   Priority 5 is the highest. */
+enum { CATCHUP_SUMMARY, CATCHUP_TOP, CATCHUP_REPLAY };
+
+int catchup_policy = CATCHUP_SUMMARY;
+int catchup_batch = 64;
+int catchup_spacing = 60;
+
+static void catch_up_list(const task_t *items, int n, const char *what) {
+    for (int i = 0; i < n; i += catchup_batch) {
+        int end = i + catchup_batch < n ? i + catchup_batch : n;
+        printf("\n====== CATCH-UP: %s %d-%d of %d ======\n", what, i + 1, end, n);
+        for (int k = i; k < end; ++k) {
+            char buf[64];
+            format_time(items[k].deadline, buf, sizeof(buf));
+            printf("  - %s%s[%s] %s (priority %d) was due at %s\n",
+                   items[k].user ? users[items[k].user].name : "", items[k].user ? ": " : "",
+                   items[k].category, items[k].title, items[k].priority, buf);
+        }
+        fflush(stdout);
+    }
+}
+
+/* Put overdue tasks back with deadlines spread catchup_batch per slot; they
+   keep their dependents waiting. Ones that do not fit are dropped. */
+static void catch_up_replay(task_t *items, int n, time_t now) {
+    int put = 0;
+    for (int i = 0; i < n; ++i) {
+        items[i].deadline = now + (time_t)(put / catchup_batch) * catchup_spacing;
+        if (store_put(&items[i])) put++;
+        else items[i - put] = items[i];
+    }
+    deps_done(items, n - put);
+    printf("Catch-up: replaying %d overdue task(s), %d every %ds.\n", put, catchup_batch, catchup_spacing);
+    if (put < n) printf("Catch-up: %d task(s) could not be requeued (store or quota full).\n", n - put);
+}
+
+void catch_up_config(void) {
+    const char *p = getenv("REMINDER_CATCHUP");
+    if (p && strcmp(p, "top") == 0) catchup_policy = CATCHUP_TOP;
+    else if (p && strcmp(p, "replay") == 0) catchup_policy = CATCHUP_REPLAY;
+    else if (p && *p && strcmp(p, "summary") != 0) fprintf(stderr, "Unknown REMINDER_CATCHUP '%s', using summary.\n", p);
+    if ((p = getenv("REMINDER_CATCHUP_BATCH")) && atoi(p) > 0) catchup_batch = atoi(p);
+    if ((p = getenv("REMINDER_CATCHUP_SPACING")) && atoi(p) > 0) catchup_spacing = atoi(p);
+}
+
+/* Run before the scheduler starts. */
+void catch_up_overdue(void) {
+    time_t now = clk->now();
+    task_t *due;
+    int n = store_take_due(now, &due);
+    if (n == 0) return;
+
+    if (catchup_policy == CATCHUP_REPLAY) {
+        catch_up_replay(due, n, now);
+    } else if (catchup_policy == CATCHUP_TOP) {
+        int top = due[0].priority, keep = 0, drop = 0;
+        for (int i = 1; i < n; ++i) if (due[i].priority > top) top = due[i].priority;
+        /* Stable split: top priority to the front, the rest after. */
+        task_t *rest = malloc(sizeof(task_t) * n);
+        for (int i = 0; i < n; ++i) {
+            if (due[i].priority == top) due[keep++] = due[i];
+            else rest[drop++] = due[i];
+        }
+        if (drop) catch_up_list(rest, drop, "missed, dropped");
+        deps_done(rest, drop);
+        free(rest);
+        catch_up_replay(due, keep, now);
+    } else {
+        catch_up_list(due, n, "missed");
+        deps_done(due, n);
+    }
+    free(due);
+    save_tasks();
+}
+
+#ifdef REMINDER_BENCH
+/* --- Benchmark tools --- */
+static unsigned long long bench_rng_state = 88172645463325252ULL;
+
+static unsigned long long bench_rand(void) {
+    unsigned long long x = bench_rng_state;
+    x ^= x << 13; x ^= x >> 7; x ^= x << 17;
+    return bench_rng_state = x;
+}
+
+static double bench_now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static long bench_peak_rss_kb(void) {
+    struct rusage ru;
+    getrusage(RUSAGE_SELF, &ru);
+    return ru.ru_maxrss;
+}
+
+/* sim: replay deadlines on the virtual clock, keeping the store topped up
+   as tasks fire. Every task must fire exactly at its deadline, in order. */
+static unsigned long long sim_target, sim_fed, sim_fired, sim_batches;
+static unsigned long long sim_late, sim_order_errors;
+static int sim_horizon;
+static time_t sim_last_fire;
+
+static void sim_feed(time_t now) {
+    if (sim_fed >= sim_target) return;
+    time_t dl = now + 1 + (time_t)(bench_rand() % (unsigned)sim_horizon);
+    if (insert_task(0, "sim", "Sim", 1 + (int)(bench_rand() % 5), dl) >= 0) sim_fed++;
+}
+
+static void sim_deliver(due_copy_t *dc) {
+    time_t now = clk->now();
+    if (now < sim_last_fire) sim_order_errors++;
+    sim_last_fire = now;
+    for (int i = 0; i < dc->count; ++i) {
+        if (dc->items[i].deadline != now) sim_late++;
+        sim_feed(now);
+    }
+    sim_fired += dc->count;
+    sim_batches++;
+    due_batch_free(dc);
+    if (sim_fired >= sim_target) scheduler_running = 0;
+}
 
-        if (nd == 0) { sleep(2); continue; }
+static int bench_sim(int argc, char **argv) {
+    unsigned long long n = 1000000;
+    int store = 256, nsh = 1, opt;
+    sim_horizon = 3600;
+    while ((opt = getopt(argc, argv, "n:s:w:r:S:")) != -1) {
+        switch (opt) {
+            case 'n': n = strtoull(optarg, NULL, 10); break;
+            case 's': store = atoi(optarg); break;
+            case 'S': nsh = atoi(optarg); break;
+            case 'w': sim_horizon = atoi(optarg); break;
+            case 'r': bench_rng_state = strtoull(optarg, NULL, 10) | 1; break;
+            default:
+                fprintf(stderr, "usage: sim [-n firings] [-s store] [-w horizon] [-r seed] [-S shards]\n");
+                return 2;
+        }
+    }
+    if (n == 0 || store <= 0 || sim_horizon <= 0) {
+        fprintf(stderr, "sim: bad arguments\n");
+        return 2;
+    }
+    max_tasks = store;
+    store_init(nsh);
+
+    task_file = NULL;
+    clk = &virtual_clock;
+    vclock_set(1700000000);
+    deliver_due = sim_deliver;
+    sim_target = n;
+    sim_last_fire = clk->now();
+    for (int i = 0; i < store; ++i) sim_feed(clk->now());
 
-        int seconds = (int)difftime(nd, now);
-        if (seconds <= 0) alarm_fired = 1;
-        else alarm(seconds);
+    time_t vstart = clk->now();
+    double t0 = bench_now_sec();
+    scheduler_run_virtual();
+    double wall = bench_now_sec() - t0;
+
+    printf("sim: shards=%d fired=%llu batches=%llu store=%d virtual=%llds wall=%.3fs rate=%.0f/s late=%llu order_errors=%llu\n",
+           nshards, sim_fired, sim_batches, store, (long long)(clk->now() - vstart), wall,
+           wall > 0 ? sim_fired / wall : 0.0, sim_late, sim_order_errors);
+    return (sim_late || sim_order_errors) ? 1 : 0;
+}
+
+/* persist: write a synthetic tasks file of each size, then time load_tasks()
+   and save_tasks() on it. One JSON object per size on stdout. */
+static void persist_gen(const char *path, long n, int title_max, int cats, int window) {
+    static const char *names[] = { "Work", "Study", "Personal", "Health", "Home",
+                                   "Finance", "Travel", "Errands" };
+    FILE *f = fopen(path, "w");
+    if (!f) { perror(path); exit(1); }
+    char title[128];
+    for (long i = 0; i < n; ++i) {
+        int len = 1 + (int)(bench_rand() % (unsigned)title_max);
+        for (int k = 0; k < len; ++k) title[k] = 'a' + (char)(bench_rand() % 26);
+        title[len] = 0;
+        fprintf(f, "%ld|%s|%s|%d|%lld\n", i + 1, title, names[bench_rand() % (unsigned)cats],
+                1 + (int)(bench_rand() % 5), 1700000000LL + (long long)(bench_rand() % (unsigned)window));
+    }
+    fclose(f);
+}
 
-        while (!alarm_fired) sleep(1);
-        alarm_fired = 0;
+/* The save path as it was before serialize_task(), kept as a baseline. */
+static void save_tasks_fprintf(void) {
+    FILE *f = fopen(task_file, "w");
+    if (!f) { perror("save_tasks_fprintf"); return; }
+    store_lock_all();
+    for (int si = 0; si < nshards; ++si) {
+        const task_t *t = shards[si].tasks;
+        for (int i = 0; i < shards[si].count; ++i)
+            fprintf(f, "%d|%s|%s|%d|%lld\n", t[i].id, t[i].title, t[i].category,
+                    t[i].priority, (long long)t[i].deadline);
+    }
+    store_unlock_all();
+    fclose(f);
+}
 
-        pthread_mutex_lock(&tasks_mutex);
-        time_t tnow = time(NULL);
-        int due_count = 0;
-        for (int i = 0; i < task_count; ++i)
-            if (tasks[i].deadline <= tnow) due_count++;
-        if (due_count == 0) { pthread_mutex_unlock(&tasks_mutex); continue; }
+static int bench_persist(int argc, char **argv) {
+    const char *sizes = "1000,10000,100000,1000000";
+    const char *path = "bench_tasks.txt";
+    int title_max = 40, cats = 3, window = 30 * 86400, opt;
+    while ((opt = getopt(argc, argv, "n:t:c:w:f:r:")) != -1) {
+        switch (opt) {
+            case 'n': sizes = optarg; break;
+            case 't': title_max = atoi(optarg); break;
+            case 'c': cats = atoi(optarg); break;
+            case 'w': window = atoi(optarg); break;
+            case 'f': path = optarg; break;
+            case 'r': bench_rng_state = strtoull(optarg, NULL, 10) | 1; break;
+            default:
+                fprintf(stderr, "usage: persist [-n sizes] [-t title] [-c cats] [-w window] [-f file] [-r seed]\n");
+                return 2;
+        }
+    }
+    if (title_max < 1 || title_max > 127 || cats < 1 || cats > 8 || window < 1) {
+        fprintf(stderr, "persist: bad arguments\n");
+        return 2;
+    }
 
-        task_t *copies = malloc(sizeof(task_t) * due_count);
-        int ci = 0, write_idx = 0;
-        for (int i = 0; i < task_count; ++i) {
-            if (tasks[i].deadline <= tnow)
-                copies[ci++] = tasks[i];
-            else
-                tasks[write_idx++] = tasks[i];
+    /* Sizes are a comma-separated list of positive numbers. */
+    for (const char *p = sizes; ; ++p) {
+        char *end;
+        if (strtol(p, &end, 10) <= 0 || end == p || (*end && *end != ',')) {
+            fprintf(stderr, "persist: bad size list '%s'\n", sizes);
+            return 2;
         }
-        task_count = write_idx;
-        pthread_mutex_unlock(&tasks_mutex);
+        if (!*(p = end)) break;
+    }
+
+    task_file = path;
+    store_init(1);
+    for (const char *p = sizes; *p; ) {
+        char *end;
+        long n = strtol(p, &end, 10);
+        p = *end ? end + 1 : end;
+        max_tasks = n > INT_MAX ? INT_MAX : (int)n;
+
+        persist_gen(path, n, title_max, cats, window);
+        struct stat st;
+        long long bytes = stat(path, &st) == 0 ? (long long)st.st_size : 0;
 
+        double t0 = bench_now_sec();
+        load_tasks();
+        double load = bench_now_sec() - t0;
+        int loaded = store_count;
+
+        t0 = bench_now_sec();
+        save_tasks_fprintf();
+        double save_fprintf = bench_now_sec() - t0;
+
+        t0 = bench_now_sec();
         save_tasks();
+        double save = bench_now_sec() - t0;
 
-        due_copy_t *dc = malloc(sizeof(due_copy_t));
-        dc->items = copies;
-        dc->count = due_count;
+        printf("{\"bench\":\"persist\",\"tasks\":%ld,\"loaded\":%d,\"file_bytes\":%lld,"
+               "\"load_sec\":%.6f,\"load_tasks_per_sec\":%.0f,\"load_mb_per_sec\":%.2f,"
+               "\"save_sec\":%.6f,\"save_tasks_per_sec\":%.0f,\"save_mb_per_sec\":%.2f,"
+               "\"save_fprintf_sec\":%.6f,\"rss_kb\":%ld,\"peak_rss_kb\":%ld}\n",
+               n, loaded, bytes,
+               load, load > 0 ? loaded / load : 0.0, load > 0 ? bytes / load / 1e6 : 0.0,
+               save, save > 0 ? loaded / save : 0.0, save > 0 ? bytes / save / 1e6 : 0.0, save_fprintf,
+               process_rss_kb(), bench_peak_rss_kb());
+        fflush(stdout);
 
-        pthread_t rt;
-        if (pthread_create(&rt, NULL, reminder_thread_fn, dc) == 0)
-            pthread_detach(rt);
-        else {
-            perror("pthread_create reminder");
-            free(copies);
-            free(dc);
+        store_clear();
+    }
+    unlink(path);
+    return 0;
+}
+
+/* micro: per-operation cost of the store hot paths. Cheap ops are timed in
+   groups of MICRO_GROUP so clock_gettime() overhead stays out of the result;
+   each sample is ns/op for one group or one call. */
+#define MICRO_GROUP 64
+#define MICRO_BASE 1700000000LL
+#define MICRO_WINDOW (7 * 86400)
+
+static double *micro_samples;
+static int micro_nsamples, micro_cap;
+
+static void micro_record(double ns) {
+    if (micro_nsamples == micro_cap) {
+        micro_cap = micro_cap ? micro_cap * 2 : 1024;
+        micro_samples = realloc(micro_samples, sizeof(double) * micro_cap);
+    }
+    micro_samples[micro_nsamples++] = ns;
+}
+
+static int cmp_double(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+static void micro_report(const char *op, int n, const char *dist, long ops) {
+    if (micro_nsamples == 0) return;
+    qsort(micro_samples, micro_nsamples, sizeof(double), cmp_double);
+    double sum = 0;
+    for (int i = 0; i < micro_nsamples; ++i) sum += micro_samples[i];
+    #define PCT(p) micro_samples[(int)((micro_nsamples - 1) * (p))]
+    printf("{\"bench\":\"micro\",\"op\":\"%s\",\"tasks\":%d,\"dist\":\"%s\",\"ops\":%ld,"
+           "\"mean_ns\":%.1f,\"p50_ns\":%.1f,\"p90_ns\":%.1f,\"p99_ns\":%.1f,\"max_ns\":%.1f}\n",
+           op, n, dist, ops, sum / micro_nsamples, PCT(0.50), PCT(0.90), PCT(0.99),
+           micro_samples[micro_nsamples - 1]);
+    #undef PCT
+    fflush(stdout);
+    micro_nsamples = 0;
+}
+
+static time_t micro_deadline(const char *dist, int i, int n) {
+    if (strcmp(dist, "sorted") == 0) return MICRO_BASE + (long long)i * MICRO_WINDOW / n;
+    if (strcmp(dist, "reverse") == 0) return MICRO_BASE + (long long)(n - i) * MICRO_WINDOW / n;
+    if (strcmp(dist, "clustered") == 0)   /* 16 hot spots, +-60s jitter */
+        return MICRO_BASE + (long long)(bench_rand() % 16) * (MICRO_WINDOW / 16) + (long long)(bench_rand() % 120);
+    return MICRO_BASE + (long long)(bench_rand() % MICRO_WINDOW);
+}
+
+static void micro_fill(const char *dist, int n) {
+    store_clear();
+    for (int i = 0; i < n; ++i)
+        insert_task(0, "micro benchmark task", "Work", 1 + i % 5, micro_deadline(dist, i, n));
+}
+
+static int micro_heap_errors;
+
+/* Checks every shard's deadline heap: order and the heap_pos back links. */
+static int store_heap_ok(void) {
+    int ok = 1;
+    for (int si = 0; si < nshards; ++si) {
+        shard_t *s = &shards[si];
+        shard_lock(s);
+        for (int pos = 0; pos < s->heap_n && ok; ++pos)
+            ok = s->tasks[s->heap[pos]].heap_pos == pos &&
+                 (pos == 0 || !heap_less(s, s->heap[pos], s->heap[(pos - 1) / 2]));
+        shard_unlock(s);
+    }
+    return ok;
+}
+
+/* Shifts scattered subsets (one priority of 64 random tasks) by +-500 s and
+   checks the heaps each time: the case where sifting one moved task at a
+   time must not see the others out of place. */
+static void micro_heap_check(void) {
+    task_filter_t f;
+    for (int run = 0; run < 2000; ++run) {
+        store_clear();
+        for (int i = 0; i < 64; ++i)
+            insert_task(0, "heap check", "Work", 1 + (int)(bench_rand() % 10),
+                        MICRO_BASE + (time_t)(bench_rand() % 3600));
+        filter_init(&f, 0);
+        f.pri_min = f.pri_max = 1 + (int)(bench_rand() % 10);
+        if (run & 1) f.to = MICRO_BASE + 1800;
+        bulk_update(&f, 0, bench_rand() & 1 ? 500 : -500);
+        if (!store_heap_ok() && micro_heap_errors++ < 10)
+            fprintf(stderr, "micro: heap broken after scattered bulk_reschedule, run %d\n", run);
+    }
+    store_clear();
+}
+
+static void micro_run(int n, const char *dist) {
+    double t0;
+    max_tasks = n;
+
+    /* insert_task: append into a store growing from empty */
+    for (int rep = 0, reps = n < 100000 ? 100000 / n : 1; rep < reps; ++rep) {
+        store_clear();
+        for (int i = 0; i < n; i += MICRO_GROUP) {
+            int g = n - i < MICRO_GROUP ? n - i : MICRO_GROUP;
+            time_t dl[MICRO_GROUP];
+            for (int k = 0; k < g; ++k) dl[k] = micro_deadline(dist, i + k, n);
+            t0 = bench_now_sec();
+            for (int k = 0; k < g; ++k) insert_task(0, "micro benchmark task", "Work", 3, dl[k]);
+            micro_record((bench_now_sec() - t0) * 1e9 / g);
         }
     }
-    return NULL;
+    micro_report("insert", n, dist, (long)n * (n < 100000 ? 100000 / n : 1));
+
+    /* next_deadline: heap tops of every shard, nothing due yet */
+    micro_fill(dist, n);
+    vclock_set(MICRO_BASE - 1);
+    long calls = n >= 1000000 ? 20 : 20000000L / n + 20;
+    for (long c = 0; c < calls; ++c) {
+        t0 = bench_now_sec();
+        next_deadline();
+        micro_record((bench_now_sec() - t0) * 1e9);
+    }
+    micro_report("next_deadline", n, dist, calls);
+
+    /* take_due: pop the earliest ~1% of the window from every shard */
+    int snap_n;
+    task_t *snapshot = store_snapshot_sorted(&snap_n);
+    long due_calls = calls < 2000 ? calls : 2000;
+    for (long c = 0; c < due_calls; ++c) {
+        store_clear();
+        for (int i = 0; i < snap_n; ++i) store_put(&snapshot[i]);
+        task_t *due;
+        t0 = bench_now_sec();
+        int k = store_take_due(MICRO_BASE + MICRO_WINDOW / 100, &due);
+        micro_record((bench_now_sec() - t0) * 1e9);
+        deps_done(due, k);
+        free(due);
+    }
+    micro_report("take_due", n, dist, due_calls);
+
+    /* update_task: move random tasks to a new deadline in place */
+    store_clear();
+    for (int i = 0; i < snap_n; ++i) store_put(&snapshot[i]);
+    free(snapshot);
+    int ups = n < 20000 ? n : 20000;
+    for (int u = 0; u < ups; ++u) {
+        task_t t;
+        int id = 1 + (int)(bench_rand() % (unsigned)n);
+        t.deadline = micro_deadline(dist, (int)(bench_rand() % (unsigned)n), n);
+        t0 = bench_now_sec();
+        update_task(0, id, &t, UPD_DEADLINE);
+        micro_record((bench_now_sec() - t0) * 1e9);
+    }
+    micro_report("update", n, dist, ups);
+
+    /* bulk_update: move the earliest ~1% of the window back and forth by
+       500 s, checking the heaps after each (outside the timing) */
+    task_filter_t f;
+    filter_init(&f, 0);
+    f.to = MICRO_BASE + MICRO_WINDOW / 100;
+    long bulks = due_calls < 200 ? due_calls : 200;
+    for (long c = 0; c < bulks; ++c) {
+        t0 = bench_now_sec();
+        bulk_update(&f, 0, c & 1 ? -500 : 500);
+        micro_record((bench_now_sec() - t0) * 1e9);
+        if (!store_heap_ok() && micro_heap_errors++ < 10)
+            fprintf(stderr, "micro %s n=%d: heap broken after bulk_reschedule %ld\n", dist, n, c);
+    }
+    micro_report("bulk_reschedule", n, dist, bulks);
+
+    /* remove_task: random ids until half the store is gone */
+    int dels = n / 2 < 20000 ? n / 2 : 20000;
+    for (int d = 0; d < dels; ++d) {
+        int id = 1 + (int)(bench_rand() % (unsigned)n);
+        t0 = bench_now_sec();
+        remove_task(0, id);
+        micro_record((bench_now_sec() - t0) * 1e9);
+    }
+    micro_report("remove", n, dist, dels);
 }
 
-/* --- main --- */
-int main(void) {
-    struct sigaction sa;
-    sa.sa_handler = sigalrm_handler;
-    sigemptyset(&sa.sa_mask);
-    sa.sa_flags = 0;
-    sigaction(SIGALRM, &sa, NULL);
+static int bench_micro(int argc, char **argv) {
+    char sizes[256] = "1000,10000,100000", dists[256] = "uniform,clustered,sorted,reverse";
+    int nsh = 1, opt;
+    while ((opt = getopt(argc, argv, "n:d:r:S:")) != -1) {
+        switch (opt) {
+            case 'S': nsh = atoi(optarg); break;
+            case 'n': snprintf(sizes, sizeof(sizes), "%s", optarg); break;
+            case 'd': snprintf(dists, sizeof(dists), "%s", optarg); break;
+            case 'r': bench_rng_state = strtoull(optarg, NULL, 10) | 1; break;
+            default:
+                fprintf(stderr, "usage: micro [-n sizes] [-d dists] [-r seed] [-S shards]\n");
+                return 2;
+        }
+    }
+    store_init(nsh);
+    task_file = NULL;
+    clk = &virtual_clock;
+    char *ssave, *dsave;
+    micro_heap_check();
+    for (char *sz = strtok_r(sizes, ",", &ssave); sz; sz = strtok_r(NULL, ",", &ssave)) {
+        int n = atoi(sz);
+        if (n <= 0) continue;
+        char dcopy[256];
+        snprintf(dcopy, sizeof(dcopy), "%s", dists);
+        for (char *d = strtok_r(dcopy, ",", &dsave); d; d = strtok_r(NULL, ",", &dsave))
+            micro_run(n, d);
+    }
+    free(micro_samples);
+    return micro_heap_errors ? 1 : 0;
+}
+
+/* load: push a deadline distribution through a running scheduler and measure
+   firing rate, lateness (deadline to delivery) and thread/memory growth.
+   Real mode runs the shard schedulers and delivers through the executor's
+   workers; virtual mode measures the scheduler loop alone. */
+static pthread_mutex_t load_mutex = PTHREAD_MUTEX_INITIALIZER;
+static long load_target, load_fired, load_batches;
+static double *load_late_ms;
+static double load_first_fire, load_last_fire;
+static int load_real;
+
+static double wall_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+static int bench_threads(void) {
+    char line[128];
+    int n = 0;
+    FILE *f = fopen("/proc/self/status", "r");
+    if (!f) return 0;
+    while (fgets(line, sizeof(line), f))
+        if (sscanf(line, "Threads: %d", &n) == 1) break;
+    fclose(f);
+    return n;
+}
+
+static void load_deliver(due_copy_t *dc) {
+    double now_ms = load_real ? wall_ms() : clk->now() * 1e3;
+    double mono = bench_now_sec();
+    pthread_mutex_lock(&load_mutex);
+    long fired = __atomic_load_n(&load_fired, __ATOMIC_RELAXED);
+    for (int i = 0; i < dc->count && fired + i < load_target; ++i)
+        load_late_ms[fired + i] = now_ms - dc->items[i].deadline * 1e3;
+    if (load_batches++ == 0) load_first_fire = mono;
+    load_last_fire = mono;
+    fired += dc->count;
+    __atomic_store_n(&load_fired, fired, __ATOMIC_RELEASE);
+    if (fired >= load_target && !load_real) scheduler_running = 0;
+    pthread_mutex_unlock(&load_mutex);
+    if (load_real) submit_reminders(dc);
+    else due_batch_free(dc);
+}
 
+static int bench_load(int argc, char **argv) {
+    const char *dist = "uniform", *mode = "virtual";
+    int window = 0, clusters = 8, verbose = 0, nsh = 1, opt;
+    load_target = 10000;
+    while ((opt = getopt(argc, argv, "n:d:w:c:m:r:S:v")) != -1) {
+        switch (opt) {
+            case 'S': nsh = atoi(optarg); break;
+            case 'n': load_target = atol(optarg); break;
+            case 'd': dist = optarg; break;
+            case 'w': window = atoi(optarg); break;
+            case 'c': clusters = atoi(optarg); break;
+            case 'm': mode = optarg; break;
+            case 'r': bench_rng_state = strtoull(optarg, NULL, 10) | 1; break;
+            case 'v': verbose = 1; break;
+            default:
+                fprintf(stderr, "usage: load [-n tasks] [-d uniform|clustered] [-c clusters] [-w window] [-m virtual|real] [-r seed] [-S shards] [-v]\n");
+                return 2;
+        }
+    }
+    load_real = strcmp(mode, "real") == 0;
+    if (window <= 0) window = load_real ? 20 : 86400;
+    if (load_target <= 0 || load_target > INT_MAX || clusters <= 0) {
+        fprintf(stderr, "load: bad arguments\n");
+        return 2;
+    }
+
+    /* Delivery prints to stdout; keep results separate. */
+    FILE *out = fdopen(dup(STDOUT_FILENO), "w");
+    if (!verbose && !freopen("/dev/null", "w", stdout)) return 1;
+
+    task_file = NULL;
+    max_tasks = (int)load_target;
+    store_init(nsh);
+    deliver_due = load_deliver;
+    load_late_ms = malloc(sizeof(double) * load_target);
+    if (load_real) {
+        executor_start(0);
+        scheduler_start();
+    } else {
+        clk = &virtual_clock;
+        vclock_set(1700000000);
+    }
+
+    time_t base = clk->now() + 1;
+    for (long i = 0; i < load_target; ++i) {
+        time_t dl = strcmp(dist, "clustered") == 0
+            ? base + (time_t)(bench_rand() % (unsigned)clusters) * (window / clusters)
+            : base + (time_t)(bench_rand() % (unsigned)window);
+        insert_task(0, "load", "Load", 1 + (int)(bench_rand() % 5), dl);
+    }
+
+    double t0 = bench_now_sec();
+    int peak_threads = bench_threads();
+    if (load_real) {
+        double limit = window + 10.0;
+        while (__atomic_load_n(&load_fired, __ATOMIC_ACQUIRE) < load_target &&
+               bench_now_sec() - t0 < limit) {
+            usleep(100000);
+            int th = bench_threads();
+            if (th > peak_threads) peak_threads = th;
+        }
+    } else {
+        scheduler_run_virtual();
+    }
+    double wall = bench_now_sec() - t0;
+
+    long fired = __atomic_load_n(&load_fired, __ATOMIC_ACQUIRE);
+    long n = fired < load_target ? fired : load_target;
+    qsort(load_late_ms, n, sizeof(double), cmp_double);
+    double sum = 0;
+    for (long i = 0; i < n; ++i) sum += load_late_ms[i];
+    double span = load_last_fire - load_first_fire;
+    #define LATE(p) (n ? load_late_ms[(long)((n - 1) * (p))] : 0.0)
+    fprintf(out, "{\"bench\":\"load\",\"mode\":\"%s\",\"shards\":%d,\"dist\":\"%s\",\"tasks\":%ld,\"window_sec\":%d,"
+            "\"fired\":%ld,\"batches\":%ld,\"wall_sec\":%.3f,\"fire_span_sec\":%.3f,\"firings_per_sec\":%.0f,"
+            "\"late_mean_ms\":%.1f,\"late_p50_ms\":%.1f,\"late_p99_ms\":%.1f,\"late_max_ms\":%.1f,"
+            "\"threads_peak\":%d,\"workers\":%d,\"jobs\":%llu,\"steals\":%llu,\"queue_peak\":%lld,"
+            "\"rss_kb\":%ld,\"peak_rss_kb\":%ld}\n",
+            mode, nshards, dist, load_target, window, fired, load_batches, wall, span,
+            span > 0 ? fired / span : (double)fired / (wall > 0 ? wall : 1),
+            n ? sum / n : 0.0, LATE(0.50), LATE(0.99), LATE(1.0),
+            peak_threads, nworkers, METRIC_GET(jobs_run), METRIC_GET(jobs_stolen), METRIC_GET(queue_peak),
+            process_rss_kb(), bench_peak_rss_kb());
+    #undef LATE
+    fclose(out);
+    /* Real mode leaves countdowns pending on the timers; don't wait for them. */
+    trace_dump();
+    _exit(fired >= load_target ? 0 : 1);
+}
+
+/* First byte the primary at sock sends a new connection ('X' if it refuses
+   it), 0 if none. With report >= 0 the byte is written there instead and
+   the connection is held open until the process is killed. */
+static char repl_probe(const char *sock, int report) {
+    struct sockaddr_un addr;
+    char c = 0;
+    int fd = repl_socket(sock, &addr);
+    if (fd >= 0 && connect(fd, (struct sockaddr *)&addr, sizeof(addr)) == 0 && read(fd, &c, 1) != 1) c = 0;
+    if (report >= 0 && write(report, &c, 1) == 1)
+        for (;;) pause();
+    if (fd >= 0) close(fd);
+    return c;
+}
+
+/* Replication: a forked standby follows this process over a unix socket
+   while n tasks are added and then removed one by one (2n frames, each
+   journaled to disk as well); each side prints one JSON line. Then a second
+   standby must be refused while it runs, and once it is gone, or another is
+   killed while the primary is idle, the next one must be attached. */
+static int bench_repl(int argc, char **argv) {
+    long n = 100000;
+    int opt;
+    while ((opt = getopt(argc, argv, "n:")) != -1) {
+        if (opt == 'n') n = atol(optarg);
+        else { fprintf(stderr, "usage: repl [-n tasks]\n"); return 2; }
+    }
+    if (n <= 0 || n > INT_MAX / 2) { fprintf(stderr, "repl: bad arguments\n"); return 2; }
+    char dir[] = "/tmp/reminder_repl_XXXXXX", sock[64], file[64], journal[80];
+    if (!mkdtemp(dir)) { perror("mkdtemp"); return 1; }
+    snprintf(sock, sizeof(sock), "%s/sock", dir);
+    snprintf(file, sizeof(file), "%s/tasks.txt", dir);
+    snprintf(journal, sizeof(journal), "%s.journal", file);
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid == 0) {
+        task_file = NULL;
+        max_tasks = INT_MAX;
+        store_init(1);
+        int synced = standby_follow(sock);
+        double secs = clock_now_precise() - standby.synced;
+        printf("{\"bench\":\"repl\",\"side\":\"standby\",\"frames\":%llu,\"bytes\":%llu,"
+               "\"frames_per_sec\":%.0f,\"lag_mean_ms\":%.3f,\"lag_max_ms\":%.3f,\"tasks_left\":%d}\n",
+               standby.frames, standby.bytes, secs > 0 ? standby.frames / secs : 0.0,
+               standby.frames ? standby.lag_sum_ms / standby.frames : 0.0, standby.lag_max_ms, store_count);
+        fflush(stdout);
+        _exit(synced ? 0 : 1);
+    }
+    task_file = file;
+    max_tasks = (int)n;
+    store_init(1);
+    if (pid < 0 || !repl_listen(sock)) return 1;
+    for (int i = 0; i < 10000 && __atomic_load_n(&repl_fd, __ATOMIC_ACQUIRE) < 0; ++i) usleep(1000);
+    double t0 = bench_now_sec();
+    for (long i = 0; i < n; ++i) insert_task(0, "replicated task", "Repl", 3, MICRO_BASE + i);
+    for (long i = 0; i < n; ++i) remove_task(0, (int)i + 1);
+    double shipped = bench_now_sec() - t0;
+    for (;;) {
+        pthread_mutex_lock(&repl_mutex);
+        size_t left = repl_len;
+        pthread_mutex_unlock(&repl_mutex);
+        if (!left) break;
+        usleep(100);
+    }
+    double drained = bench_now_sec() - t0;
+    /* A second standby must be told no rather than handed an empty stream. */
+    int refused = repl_probe(sock, -1) == 'X';
+    if (!refused) fprintf(stderr, "repl: second standby was not refused\n");
+    shutdown(__atomic_load_n(&repl_fd, __ATOMIC_ACQUIRE), SHUT_WR);
+    int status = 1;
+    waitpid(pid, &status, 0);
+    /* Nothing is shipped from here on, so only the hangup shows the standby
+       is gone: one restarted after it, then one killed, must be attached. */
+    int pipefd[2], reattached = 0;
+    char first = 0;
+    pid_t idle = pipe(pipefd) == 0 ? fork() : -1;
+    if (idle == 0) {
+        repl_probe(sock, pipefd[1]);                /* held until killed below */
+        _exit(0);
+    }
+    if (idle > 0) {
+        close(pipefd[1]);
+        if (read(pipefd[0], &first, 1) != 1) first = 0;
+        close(pipefd[0]);
+        usleep(100000);
+        kill(idle, SIGKILL);
+        waitpid(idle, NULL, 0);
+        reattached = first && first != 'X' && (first = repl_probe(sock, -1)) && first != 'X';
+    }
+    if (!reattached) fprintf(stderr, "repl: standby restarted while idle was refused\n");
+    printf("{\"bench\":\"repl\",\"side\":\"primary\",\"tasks\":%ld,\"frames\":%llu,\"bytes\":%llu,"
+           "\"ship_sec\":%.6f,\"drain_sec\":%.6f,\"changes_per_sec\":%.0f}\n",
+           n, METRIC_GET(repl_frames), METRIC_GET(repl_bytes), shipped, drained, 2 * n / drained);
+    unlink(journal);
+    unlink(file);
+    unlink(sock);
+    rmdir(dir);
+    return refused && reattached && WIFEXITED(status) && WEXITSTATUS(status) == 0 ? 0 : 1;
+}
+
+/* archive: the columnar snapshot format against the text file it replaces,
+   for size and for decoding the same tasks back into memory. */
+static int bench_archive(int argc, char **argv) {
+    long n = 1000000;
+    int opt;
+    while ((opt = getopt(argc, argv, "n:")) != -1) {
+        if (opt == 'n') n = atol(optarg);
+        else { fprintf(stderr, "usage: archive [-n tasks]\n"); return 2; }
+    }
+    if (n <= 0 || n > INT_MAX) { fprintf(stderr, "archive: bad arguments\n"); return 2; }
+    char dir[] = "/tmp/reminder_archive_XXXXXX", txt[64], col[64];
+    if (!mkdtemp(dir)) { perror("mkdtemp"); return 1; }
+    snprintf(txt, sizeof(txt), "%s/snap.txt", dir);
+    snprintf(col, sizeof(col), "%s/snap.col", dir);
+    persist_gen(txt, n, 40, 3, 30 * 86400);
+
+    task_t *a, *b;
+    double t0 = bench_now_sec();
+    int na = col_read_text(txt, &a);
+    double scan_text = bench_now_sec() - t0;
+    col_buf_t buf = { 0 };
+    t0 = bench_now_sec();
+    int ok = na >= 0 && col_encode(a, na, &buf);
+    double encode = bench_now_sec() - t0;
+    FILE *f = fopen(col, "w");
+    ok = ok && f && fwrite(buf.p, 1, buf.n, f) == buf.n;
+    if (f) fclose(f);
+    t0 = bench_now_sec();
+    int nb = ok ? col_read(col, &b) : -1;
+    double scan_col = bench_now_sec() - t0;
+
+    int mismatches = nb == na ? 0 : 1;
+    for (int i = 0; i < na && i < nb; ++i)
+        mismatches += a[i].id != b[i].id || a[i].deadline != b[i].deadline || a[i].priority != b[i].priority ||
+                      strcmp(a[i].title, b[i].title) != 0 || strcmp(a[i].category, b[i].category) != 0;
+    struct stat st;
+    long long text_bytes = stat(txt, &st) == 0 ? (long long)st.st_size : 0;
+    printf("{\"bench\":\"archive\",\"tasks\":%d,\"text_bytes\":%lld,\"col_bytes\":%zu,\"ratio\":%.2f,"
+           "\"scan_text_sec\":%.3f,\"encode_sec\":%.3f,\"scan_col_sec\":%.3f,\"scan_speedup\":%.1f,"
+           "\"mismatches\":%d}\n",
+           na, text_bytes, buf.n, buf.n ? (double)text_bytes / buf.n : 0.0,
+           scan_text, encode, scan_col, scan_col > 0 ? scan_text / scan_col : 0.0, mismatches);
+    free(a);
+    if (nb >= 0) free(b);
+    free(buf.p);
+    unlink(txt);
+    unlink(col);
+    rmdir(dir);
+    return ok && !mismatches ? 0 : 1;
+}
+
+/* Point-in-time recovery: a store of n tasks is checkpointed, a tenth of it
+   is edited through the journal, then every task of priority 1-2 is bulk
+   deleted; the bench times recovering the state from just before the
+   delete. */
+static int bench_pitr(int argc, char **argv) {
+    long n = 1000000;
+    int opt;
+    while ((opt = getopt(argc, argv, "n:")) != -1) {
+        if (opt == 'n') n = atol(optarg);
+        else { fprintf(stderr, "usage: pitr [-n tasks]\n"); return 2; }
+    }
+    if (n <= 0 || n > INT_MAX) { fprintf(stderr, "pitr: bad arguments\n"); return 2; }
+    char dir[] = "/tmp/reminder_pitr_XXXXXX", file[64];
+    if (!mkdtemp(dir)) { perror("mkdtemp"); return 1; }
+    snprintf(file, sizeof(file), "%s/tasks.txt", dir);
+    task_file = file;
+    max_tasks = (int)n;
+    history_keep_us = 86400e6;
+    store_init(1);
+    persist_gen(file, n, 40, 3, 30 * 86400);
     load_tasks();
+    save_tasks();
+    double t0 = bench_now_sec();
+    task_t upd;
+    for (long i = 0; i < n / 10; ++i) {
+        upd.deadline = 1700000000LL + (long long)(bench_rand() % (30 * 86400));
+        update_task(0, (int)(i * 10 + 1), &upd, UPD_DEADLINE);
+    }
+    double edit = bench_now_sec() - t0;
+    usleep(1000);
+    long long before = (long long)(clock_now_precise() * 1e6);
+    usleep(1000);
+    task_filter_t f;
+    filter_init(&f, 0);
+    f.pri_max = 2;
+    int deleted = bulk_update(&f, 1, 0);
+    t0 = bench_now_sec();
+    int recovered = recover_user(0, before);
+    double rec = bench_now_sec() - t0;
+    printf("{\"bench\":\"pitr\",\"tasks\":%ld,\"edits\":%ld,\"edit_sec\":%.3f,\"deleted\":%d,"
+           "\"recovered\":%d,\"recover_sec\":%.3f,\"recover_tasks_per_sec\":%.0f,\"peak_rss_kb\":%ld}\n",
+           n, n / 10, edit, deleted, recovered, rec, rec > 0 ? recovered / rec : 0.0, bench_peak_rss_kb());
+    char cmd[128];
+    snprintf(cmd, sizeof(cmd), "rm -rf '%s'", dir);
+    return system(cmd) == 0 && recovered == (int)n ? 0 : 1;
+}
 
-    pthread_t scheduler;
-    pthread_create(&scheduler, NULL, scheduler_thread_fn, NULL);
+/* timefmt: check format_time() against strftime on random instants and on
+   every minute around each offset change in the current TZ, then time both. */
+static int bench_timefmt(int argc, char **argv) {
+    long samples = 1000000;
+    int opt;
+    while ((opt = getopt(argc, argv, "n:r:")) != -1) {
+        switch (opt) {
+            case 'n': samples = atol(optarg); break;
+            case 'r': bench_rng_state = strtoull(optarg, NULL, 10) | 1; break;
+            default: fprintf(stderr, "usage: timefmt [-n samples] [-r seed]\n"); return 2;
+        }
+    }
+    const time_t lo = 0, hi = 4102444800LL;   /* 1970 .. 2100 */
+    char a[64], b[64];
+    long checked = 0, mismatches = 0;
+    #define CHECK(t) do { \
+        time_t t_ = (t); format_time(t_, a, sizeof(a)); format_time_strftime(t_, b, sizeof(b)); \
+        checked++; \
+        if (strcmp(a, b) != 0 && mismatches++ < 10) \
+            fprintf(stderr, "mismatch at %lld: %s vs %s\n", (long long)t_, a, b); \
+    } while (0)
+    for (long i = 0; i < samples; ++i) CHECK(lo + (time_t)(bench_rand() % (unsigned long long)(hi - lo)));
+    long transitions = 0;
+    for (time_t t = lo; t < hi; t += 3600)
+        if (tz_offset_raw(t) != tz_offset_raw(t + 3600)) {
+            transitions++;
+            for (time_t u = t - 7200; u < t + 3 * 3600; u += 60) CHECK(u);
+        }
+    #undef CHECK
+
+    time_t *ts = malloc(sizeof(time_t) * 100000);
+    time_t base = time(NULL);
+    for (int i = 0; i < 100000; ++i) ts[i] = base + (time_t)(bench_rand() % (30 * 86400));
+    double t0 = bench_now_sec();
+    for (int r = 0; r < 10; ++r) for (int i = 0; i < 100000; ++i) format_time(ts[i], a, sizeof(a));
+    double fast = (bench_now_sec() - t0) * 1e9 / 1e6;
+    t0 = bench_now_sec();
+    for (int r = 0; r < 10; ++r) for (int i = 0; i < 100000; ++i) format_time_strftime(ts[i], b, sizeof(b));
+    double slow = (bench_now_sec() - t0) * 1e9 / 1e6;
+    free(ts);
+
+    const char *tz = getenv("TZ");
+    printf("{\"bench\":\"timefmt\",\"tz\":\"%s\",\"checked\":%ld,\"transitions\":%ld,\"mismatches\":%ld,"
+           "\"fast_ns\":%.1f,\"strftime_ns\":%.1f,\"speedup\":%.1f}\n",
+           tz ? tz : "", checked, transitions, mismatches, fast, slow, fast > 0 ? slow / fast : 0.0);
+    return mismatches ? 1 : 0;
+}
+
+/* timeparse: round-trip random instants through "YYYY-MM-DD HH:MM:SS" and
+   ISO forms, compare with strptime + mktime, and time both paths. */
+static int bench_timeparse(int argc, char **argv) {
+    long samples = 1000000;
+    int opt;
+    while ((opt = getopt(argc, argv, "n:r:")) != -1) {
+        switch (opt) {
+            case 'n': samples = atol(optarg); break;
+            case 'r': bench_rng_state = strtoull(optarg, NULL, 10) | 1; break;
+            default: fprintf(stderr, "usage: timeparse [-n samples] [-r seed]\n"); return 2;
+        }
+    }
+    const time_t lo = 0, hi = 4102444800LL;
+    long errors = 0, ambiguous = 0, mktime_diff = 0;
+    char buf[64];
+    for (long i = 0; i < samples; ++i) {
+        time_t t = lo + (time_t)(bench_rand() % (unsigned long long)(hi - lo)), got;
+        struct tm tm;
+        localtime_r(&t, &tm);
+        strftime(buf, sizeof(buf), "%Y-%m-%d %H:%M:%S", &tm);
+        if (!parse_deadline(buf, &got)) { if (errors++ < 10) fprintf(stderr, "rejected %s\n", buf); continue; }
+        if (got != t) {
+            /* Only legitimate when the wall time occurs twice. */
+            if (got < t && tz_offset(got) != tz_offset(t)) ambiguous++;
+            else if (errors++ < 10) fprintf(stderr, "%s: got %lld want %lld\n", buf, (long long)got, (long long)t);
+        }
+        struct tm m = {0};
+        strptime(buf, "%Y-%m-%d %H:%M:%S", &m);
+        m.tm_isdst = -1;
+        if (mktime(&m) != got) mktime_diff++;
+
+        snprintf(buf, sizeof(buf), "%04d-%02d-%02dT%02d:%02d:%02d%c%02ld:%02ld",
+                 tm.tm_year + 1900, tm.tm_mon + 1, tm.tm_mday, tm.tm_hour, tm.tm_min, tm.tm_sec,
+                 tm.tm_gmtoff < 0 ? '-' : '+', labs(tm.tm_gmtoff) / 3600, labs(tm.tm_gmtoff) / 60 % 60);
+        if (!parse_deadline(buf, &got) || got != t) {
+            if (errors++ < 10) fprintf(stderr, "iso %s: got %lld want %lld\n", buf, (long long)got, (long long)t);
+        }
+    }
+    static const char *rejects[] = { "2024-13-01 10:00", "2024-02-30 10:00", "2024-01-01 24:00",
+                                     "2024-1-01 10:00", "2024-01-01 10:00Z", "@12x", "", "tomorrow",
+                                     "2026", "2024-01-01T10:00+99:99", "2024-01-01T10:00+14:30",
+                                     "2024-01-01T10:00-09:60" };
+    for (size_t i = 0; i < sizeof(rejects) / sizeof(rejects[0]); ++i) {
+        time_t t;
+        if (parse_deadline(rejects[i], &t) && errors++ < 10) fprintf(stderr, "accepted '%s'\n", rejects[i]);
+    }
+
+    enum { N = 100000 };
+    char (*strs)[24] = malloc(sizeof(*strs) * N);
+    time_t base = time(NULL), t;
+    for (int i = 0; i < N; ++i) {
+        time_t u = base + (time_t)(bench_rand() % (365 * 86400));
+        struct tm tm;
+        localtime_r(&u, &tm);
+        strftime(strs[i], sizeof(strs[i]), "%Y-%m-%d %H:%M", &tm);
+    }
+    volatile time_t sink = 0;
+    double t0 = bench_now_sec();
+    for (int r = 0; r < 10; ++r) for (int i = 0; i < N; ++i) { parse_deadline(strs[i], &t); sink += t; }
+    double fast = (bench_now_sec() - t0) * 1e9 / (10.0 * N);
+    t0 = bench_now_sec();
+    for (int r = 0; r < 10; ++r) for (int i = 0; i < N; ++i) {
+        struct tm tm = {0};
+        strptime(strs[i], "%Y-%m-%d %H:%M", &tm);
+        tm.tm_isdst = -1;
+        sink += mktime(&tm);
+    }
+    double slow = (bench_now_sec() - t0) * 1e9 / (10.0 * N);
+    free(strs);
+
+    const char *tz = getenv("TZ");
+    printf("{\"bench\":\"timeparse\",\"tz\":\"%s\",\"samples\":%ld,\"errors\":%ld,\"ambiguous\":%ld,"
+           "\"mktime_diff\":%ld,\"fast_ns\":%.1f,\"strptime_mktime_ns\":%.1f,\"speedup\":%.1f}\n",
+           tz ? tz : "", samples, errors, ambiguous, mktime_diff, fast, slow, fast > 0 ? slow / fast : 0.0);
+    return errors ? 1 : 0;
+}
+
+/* catchup: n prerequisites overdue at startup, each gating a dependent due
+   just after startup. Under replay and top every dependent must still be
+   parked after catch-up and fire only after its prerequisite; one JSON line
+   per policy. */
+static int bench_catchup(int argc, char **argv) {
+    long n = 1000;
+    int opt;
+    while ((opt = getopt(argc, argv, "n:")) != -1) {
+        if (opt == 'n') n = atol(optarg);
+        else { fprintf(stderr, "usage: catchup [-n pairs]\n"); return 2; }
+    }
+    if (n <= 0 || n > INT_MAX / 4) { fprintf(stderr, "catchup: bad arguments\n"); return 2; }
+    store_init(1);
+    task_file = NULL;
+    clk = &virtual_clock;
+    max_tasks = (int)(2 * n);
+    int *round = malloc(sizeof(int) * (2 * n + 1));
+    if (!round) return 1;
+    static const int policy[] = { CATCHUP_REPLAY, CATCHUP_TOP };
+    static const char *name[] = { "replay", "top" };
+    time_t now = MICRO_BASE;
+    long failed = 0;
+    for (int p = 0; p < 2; ++p) {
+        store_clear();
+        vclock_set(now);
+        for (long i = 0; i < n; ++i) {
+            int pre = insert_task(0, "prerequisite", "Work", 5, now - 1 - (time_t)i);
+            int dep = insert_task(0, "dependent", "Work", 5, now + 1);
+            task_add_after(0, dep, pre);
+        }
+        catchup_policy = policy[p];
+        catch_up_overdue();
+        long parked = 0, errors = 0, rounds = 0;
+        for (long i = 0; i < n; ++i) {
+            task_t t;
+            if (get_task(0, (int)(2 * i + 2), &t) && t.heap_pos < 0 && t.after[0] == (int)(2 * i + 1)) parked++;
+        }
+        memset(round, 0, sizeof(int) * (2 * n + 1));
+        for (time_t t = now; store_count > 0 && t < now + (time_t)(n + 2) * catchup_spacing; t += catchup_spacing) {
+            task_t *due;
+            int k;
+            while ((k = store_take_due(t, &due)) > 0) {
+                ++rounds;
+                for (int i = 0; i < k; ++i) round[due[i].id] = (int)rounds;
+                deps_done(due, k);
+                free(due);
+            }
+        }
+        for (long i = 0; i < n; ++i)
+            if (!round[2 * i + 1] || round[2 * i + 2] <= round[2 * i + 1]) errors++;
+        errors += n - parked;
+        failed += errors;
+        printf("{\"bench\":\"catchup\",\"policy\":\"%s\",\"pairs\":%ld,\"parked\":%ld,\"rounds\":%ld,\"errors\":%ld}\n",
+               name[p], n, parked, rounds, errors);
+    }
+    free(round);
+    return failed ? 1 : 0;
+}
+
+int main(int argc, char **argv) {
+    int rc = 2;
+    trace_init();
+    trace_thread_name("main");
+    if (argc >= 2 && strcmp(argv[1], "load") == 0) rc = bench_load(argc - 1, argv + 1);
+    else if (argc >= 2 && strcmp(argv[1], "sim") == 0) rc = bench_sim(argc - 1, argv + 1);
+    else if (argc >= 2 && strcmp(argv[1], "persist") == 0) rc = bench_persist(argc - 1, argv + 1);
+    else if (argc >= 2 && strcmp(argv[1], "micro") == 0) rc = bench_micro(argc - 1, argv + 1);
+    else if (argc >= 2 && strcmp(argv[1], "timefmt") == 0) rc = bench_timefmt(argc - 1, argv + 1);
+    else if (argc >= 2 && strcmp(argv[1], "timeparse") == 0) rc = bench_timeparse(argc - 1, argv + 1);
+    else if (argc >= 2 && strcmp(argv[1], "repl") == 0) rc = bench_repl(argc - 1, argv + 1);
+    else if (argc >= 2 && strcmp(argv[1], "pitr") == 0) rc = bench_pitr(argc - 1, argv + 1);
+    else if (argc >= 2 && strcmp(argv[1], "archive") == 0) rc = bench_archive(argc - 1, argv + 1);
+    else if (argc >= 2 && strcmp(argv[1], "catchup") == 0) rc = bench_catchup(argc - 1, argv + 1);
+    else fprintf(stderr, "usage: %s sim|persist|micro|load|timefmt|timeparse|repl|pitr|archive|catchup [options]\n", argv[0]);
+    trace_dump();
+    return rc;
+}
+#else
+/* --- main --- */
+int main(void) {
+    const char *e = getenv("REMINDER_SHARDS");
+    store_init(e ? atoi(e) : 1);
+    trace_init();
+    trace_thread_name("main");
+    metrics_start();
+    history_config();
+    part_config();
+    if ((e = getenv("REMINDER_STANDBY")) && *e) {
+        if (!standby_follow(e)) return 1;
+        standby_takeover();
+    } else {
+        load_tasks();
+    }
+    if (history_keep_us) save_tasks();     /* a base snapshot for recovery */
+    if ((e = getenv("REMINDER_REPLICATE")) && *e && !repl_listen(e))
+        fprintf(stderr, "Replication disabled.\n");
+    if ((e = getenv("REMINDER_USER")) && *e && (current_user = user_find(e, 1)) < 0) {
+        fprintf(stderr, "Invalid REMINDER_USER '%s', using default.\n", e);
+        current_user = 0;
+    }
+    catch_up_config();
+    digest_config();
+    escalation_config();
+    executor_start(0);
+    part_watch();
+    escalation_load();
+    catch_up_overdue();
+    scheduler_start();
 
     while (1) {
-        printf("\n=== Personal Task Reminder ===\n");
-        printf("1) View tasks\n2) Add task\n3) Delete task\n4) Save & Exit\nChoice: ");
+        if (current_user) printf("\n=== Personal Task Reminder (%s) ===\n", users[current_user].name);
+        else printf("\n=== Personal Task Reminder ===\n");
+        printf("1) View tasks\n2) Add task\n3) Delete task\n4) Save & Exit\n5) Memory usage\n6) Switch user\n7) Edit task\n8) Bulk delete/reschedule\n9) Add dependency\n10) Acknowledge reminder\n11) Recover tasks as of a time\nChoice: ");
         int c;
         if (scanf("%d", &c) != 1) { while(getchar()!='\n'); continue; }
         while(getchar()!='\n');
@@ -283,10 +5850,23 @@ int main(void) {
             case 2: add_task(); break;
             case 3: delete_task(); break;
             case 4:
+                digest_flush(NULL);
                 save_tasks();
+                trace_dump();
+                metrics_write();
+                memory_report(stdout);
                 printf("Exiting...\n");
+                fflush(stdout);
                 _exit(0);
+            case 5: memory_report(stdout); break;
+            case 6: switch_user(); break;
+            case 7: edit_task(); break;
+            case 8: bulk_tasks(); break;
+            case 9: add_dependency(); break;
+            case 10: ack_reminder(); break;
+            case 11: recover_tasks(); break;
             default: printf("Invalid.\n");
         }
     }
 }
+#endif